@@ -1,5 +1,6 @@
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <chrono>
 #include <random>
@@ -9,9 +10,44 @@
 #include <algorithm>
 #include <fstream>
 #include <utility>
+#include <type_traits>
 #include <memory>
 #include <stdexcept>
+#include <iterator>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <shared_mutex>
+#include <charconv>
+#include <cmath>
+#include <array>
+#include <filesystem>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#else
 #include <windows.h>
+#include <psapi.h>
+#endif
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
 
 
 /// @brief Перечисление для цвета узлов Красно-Черного дерева.
@@ -68,26 +104,108 @@ struct DataObject {
 };
 
 
+/// @brief Способ выбора длины ключа при генерации данных.
+enum KeyLengthKind {
+    /// @brief Все ключи длины min_key_length.
+    KEY_LENGTH_FIXED,
+    /// @brief Длина равномерно распределена в [min_key_length, max_key_length], строчные латинские буквы.
+    KEY_LENGTH_UNIFORM,
+    /// @brief Длинные ключи в духе URL/UUID: равномерная длина, алфавит из букв, цифр и символов "/-._".
+    KEY_LENGTH_URL
+};
+
+/// @brief Профиль генерируемого набора данных.
+/// Значения по умолчанию воспроизводят исходный generateData: ключи из 3-10 строчных букв,
+/// size / 5 различных ключей, равномерная кратность дубликатов.
+struct DataProfile {
+    /// @brief Имя профиля (для вывода и CSV).
+    std::string name = "default";
+    /// @brief Распределение длины ключа.
+    KeyLengthKind key_length = KEY_LENGTH_UNIFORM;
+    /// @brief Минимальная длина ключа (включая общий префикс).
+    size_t min_key_length = 3;
+    /// @brief Максимальная длина ключа (включая общий префикс).
+    size_t max_key_length = 10;
+    /// @brief Доля различных ключей от размера набора (не менее 10 ключей).
+    double distinct_ratio = 0.2;
+    /// @brief Показатель распределения Ципфа для кратности дубликатов; 0 - равномерное распределение.
+    double zipf_exponent = 0.0;
+    /// @brief Число общих префиксов, между которыми распределяются ключи; 0 - без общих префиксов.
+    size_t shared_prefixes = 0;
+    /// @brief Длина общего префикса.
+    size_t prefix_length = 0;
+};
+
+/// @brief Алфавит синтетических ключей: первые 26 символов - строчные латинские буквы,
+/// весь алфавит используется для ключей KEY_LENGTH_URL.
+constexpr char URL_KEY_ALPHABET[] = "abcdefghijklmnopqrstuvwxyz0123456789/-._";
+
+/// @brief Возвращает набор профилей, по которым сравниваются движки.
+/// @return Вектор профилей: исходный, фиксированная длина, длинные URL-ключи, перекос Ципфа,
+/// малое число различных ключей, общие префиксы и их сочетание с длинными ключами и перекосом.
+std::vector<DataProfile> standardDataProfiles() {
+    std::vector<DataProfile> profiles(7);
+    profiles[1].name = "fixed_16";
+    profiles[1].key_length = KEY_LENGTH_FIXED;
+    profiles[1].min_key_length = profiles[1].max_key_length = 16;
+    profiles[2].name = "url_36_200";
+    profiles[2].key_length = KEY_LENGTH_URL;
+    profiles[2].min_key_length = 36;
+    profiles[2].max_key_length = 200;
+    profiles[3].name = "zipf_1.1";
+    profiles[3].zipf_exponent = 1.1;
+    profiles[4].name = "few_distinct";
+    profiles[4].distinct_ratio = 0.001;
+    profiles[5].name = "shared_prefix";
+    profiles[5].min_key_length = 12;
+    profiles[5].max_key_length = 20;
+    profiles[5].shared_prefixes = 16;
+    profiles[5].prefix_length = 10;
+    profiles[6].name = "url_prefix_zipf";
+    profiles[6].key_length = KEY_LENGTH_URL;
+    profiles[6].min_key_length = 36;
+    profiles[6].max_key_length = 200;
+    profiles[6].shared_prefixes = 64;
+    profiles[6].prefix_length = 28;
+    profiles[6].zipf_exponent = 0.9;
+    return profiles;
+}
+
 /// @brief Генерирует вектор объектов DataObject заданного размера.
 /// @param size Количество объектов для генерации.
+/// @param profile Профиль набора данных (длины ключей, число различных ключей, перекос, префиксы).
 /// @return Вектор сгенерированных объектов DataObject.
 /// @note Ключи генерируются таким образом, чтобы допустить дубликаты.
-std::vector<DataObject> generateData(size_t size) {
+std::vector<DataObject> generateData(size_t size, const DataProfile& profile = DataProfile()) {
     std::vector<DataObject> data;
     if (size == 0) return data;
 
     data.reserve(size);
     std::mt19937 gen(std::random_device{}());
 
-    size_t num_unique_keys = std::max(static_cast<size_t>(10), size / 5);
+    std::uniform_int_distribution<> char_dist('a', 'z');
+    std::uniform_int_distribution<size_t> url_char_dist(0, sizeof(URL_KEY_ALPHABET) - 2);
+    auto randomChar = [&]() {
+        return profile.key_length == KEY_LENGTH_URL ? URL_KEY_ALPHABET[url_char_dist(gen)] : static_cast<char>(char_dist(gen));
+    };
+
+    std::vector<std::string> prefixes(profile.shared_prefixes);
+    for (auto& prefix : prefixes) {
+        for (size_t j = 0; j < profile.prefix_length; ++j) {
+            prefix += randomChar();
+        }
+    }
+
+    size_t num_unique_keys = std::max(static_cast<size_t>(10), static_cast<size_t>(size * profile.distinct_ratio));
     std::vector<std::string> possible_keys;
     possible_keys.reserve(num_unique_keys);
-    std::uniform_int_distribution<> char_dist('a', 'z');
+    std::uniform_int_distribution<size_t> len_dist(profile.min_key_length, std::max(profile.min_key_length, profile.max_key_length));
     for (size_t i = 0; i < num_unique_keys; ++i) {
-        std::string key = "";
-        size_t key_len = std::uniform_int_distribution<size_t>(3, 10)(gen);
-        for(size_t j = 0; j < key_len; ++j) {
-            key += char_dist(gen);
+        std::string key = prefixes.empty() ? "" : prefixes[i % prefixes.size()];
+        size_t key_len = profile.key_length == KEY_LENGTH_FIXED ? profile.min_key_length : len_dist(gen);
+        key_len = std::max(key_len, key.size() + 1);
+        while (key.size() < key_len) {
+            key += randomChar();
         }
         possible_keys.push_back(key);
     }
@@ -96,24 +214,236 @@ std::vector<DataObject> generateData(size_t size) {
         possible_keys.push_back("defaultkey");
     }
 
+    // Кратность дубликатов: равномерная или по закону Ципфа (ключ ранга r выбирается с весом 1 / r^s).
+    std::vector<double> zipf_cdf;
+    if (profile.zipf_exponent > 0.0) {
+        zipf_cdf.reserve(possible_keys.size());
+        double total = 0.0;
+        for (size_t r = 1; r <= possible_keys.size(); ++r) {
+            total += 1.0 / std::pow(static_cast<double>(r), profile.zipf_exponent);
+            zipf_cdf.push_back(total);
+        }
+    }
+    std::uniform_real_distribution<> zipf_dist(0.0, zipf_cdf.empty() ? 1.0 : zipf_cdf.back());
 
     std::uniform_int_distribution<> key_dist(0, possible_keys.size() - 1);
     std::uniform_int_distribution<> val1_dist(1, 1000);
     std::uniform_real_distribution<> val2_dist(0.0, 100.0);
 
     for (size_t i = 0; i < size; ++i) {
-        std::string random_key = possible_keys[key_dist(gen)];
+        size_t key_index = zipf_cdf.empty()
+            ? static_cast<size_t>(key_dist(gen))
+            : std::min(static_cast<size_t>(std::upper_bound(zipf_cdf.begin(), zipf_cdf.end(), zipf_dist(gen)) - zipf_cdf.begin()),
+                       possible_keys.size() - 1);
+        std::string random_key = possible_keys[key_index];
         data.emplace_back(random_key, val1_dist(gen), val2_dist(gen));
     }
     return data;
 }
 
 
+/// @brief Шаг генератора SplitMix64: быстрый 64-битный генератор псевдослучайных чисел.
+/// @param state Состояние генератора (изменяется).
+/// @return Очередное псевдослучайное число.
+inline uint64_t splitMix64(uint64_t& state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/// @brief Генератор xoshiro256** (Blackman, Vigna): в разы быстрее std::mt19937 при 256 битах состояния.
+class Xoshiro256 {
+private:
+    uint64_t s[4];
+
+    static uint64_t rotl(uint64_t x, int k) {
+        return (x << k) | (x >> (64 - k));
+    }
+
+public:
+    /// @brief Конструктор: состояние заполняется из зерна через SplitMix64.
+    /// @param seed Зерно генератора.
+    explicit Xoshiro256(uint64_t seed) {
+        for (auto& word : s) word = splitMix64(seed);
+    }
+
+    /// @brief Возвращает очередное 64-битное число.
+    uint64_t next() {
+        const uint64_t result = rotl(s[1] * 5, 7) * 9;
+        const uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+        return result;
+    }
+
+    /// @brief Возвращает число в диапазоне [0, bound).
+    uint64_t below(uint64_t bound) {
+        return next() % bound;
+    }
+
+    /// @brief Возвращает число с плавающей точкой в диапазоне [0, 1).
+    double unit() {
+        return static_cast<double>(next() >> 11) * (1.0 / 9007199254740992.0);
+    }
+};
+
+/// @brief Строит в key ключ с номером keyId по профилю. Длина и символы определяются номером
+/// детерминированно, поэтому пул уникальных ключей не нужен, а память строки переиспользуется.
+/// @param key Строка-приемник.
+/// @param keyId Номер ключа.
+/// @param profile Профиль (длины ключей и алфавит).
+/// @param prefixes Общие префиксы; ключ keyId получает префикс keyId % prefixes.size().
+void writeSyntheticKey(std::string& key, uint64_t keyId, const DataProfile& profile,
+                       const std::vector<std::string>& prefixes) {
+    const uint64_t alphabet = profile.key_length == KEY_LENGTH_URL ? sizeof(URL_KEY_ALPHABET) - 1 : 26;
+    uint64_t state = keyId;
+    size_t maxLength = std::max(profile.min_key_length, profile.max_key_length);
+    size_t length = profile.key_length == KEY_LENGTH_FIXED
+        ? profile.min_key_length
+        : profile.min_key_length + static_cast<size_t>(splitMix64(state) % (maxLength - profile.min_key_length + 1));
+    if (prefixes.empty()) {
+        key.clear();
+    } else {
+        key.assign(prefixes[keyId % prefixes.size()]);
+    }
+    size_t start = key.size();
+    key.resize(std::max(length, start + 1));
+    uint64_t bits = 0;
+    int charsLeft = 0;
+    for (size_t i = start; i < key.size(); ++i) {
+        // Одно 64-битное число дает 12 символов: 40^12 < 2^64.
+        if (charsLeft == 0) {
+            bits = splitMix64(state);
+            charsLeft = 12;
+        }
+        key[i] = URL_KEY_ALPHABET[bits % alphabet];
+        bits /= alphabet;
+        --charsLeft;
+    }
+}
+
+/// @brief Детерминированно строит ключ по его номеру (по умолчанию 3-10 строчных латинских букв, как в generateData).
+/// Позволяет порождать данные потоком, не храня пул уникальных ключей в памяти.
+/// @param keyId Номер ключа.
+/// @param profile Профиль набора данных.
+/// @param prefixes Общие префиксы профиля.
+/// @return Ключ.
+std::string makeSyntheticKey(uint64_t keyId, const DataProfile& profile = DataProfile(),
+                             const std::vector<std::string>& prefixes = {}) {
+    std::string key;
+    writeSyntheticKey(key, keyId, profile, prefixes);
+    return key;
+}
+
+/// @brief Строит общие префиксы профиля.
+/// @param profile Профиль набора данных.
+/// @param seed Зерно генератора.
+/// @return profile.shared_prefixes префиксов длины profile.prefix_length.
+std::vector<std::string> makeSyntheticPrefixes(const DataProfile& profile, uint64_t seed) {
+    const uint64_t alphabet = profile.key_length == KEY_LENGTH_URL ? sizeof(URL_KEY_ALPHABET) - 1 : 26;
+    Xoshiro256 rng(seed);
+    std::vector<std::string> prefixes(profile.shared_prefixes, std::string(profile.prefix_length, 'a'));
+    for (auto& prefix : prefixes) {
+        for (auto& c : prefix) c = URL_KEY_ALPHABET[rng.below(alphabet)];
+    }
+    return prefixes;
+}
+
+/// @brief Возвращает номер ключа с распределением, близким к закону Ципфа, обращением
+/// непрерывной функции распределения (без таблицы на все ключи).
+/// @param u Равномерное случайное число из [0, 1).
+/// @param n Число ключей.
+/// @param s Показатель распределения.
+/// @return Номер в диапазоне [0, n); малые номера встречаются чаще.
+inline uint64_t sampleZipfRank(double u, uint64_t n, double s) {
+    double rank;
+    if (std::abs(s - 1.0) < 1e-9) {
+        rank = std::pow(static_cast<double>(n) + 1.0, u);
+    } else {
+        double a = 1.0 - s;
+        rank = std::pow(u * (std::pow(static_cast<double>(n) + 1.0, a) - 1.0) + 1.0, 1.0 / a);
+    }
+    return std::min(n - 1, static_cast<uint64_t>(rank) - 1);
+}
+
+/// @brief Размер фрагмента параллельной генерации. Зерно фрагмента зависит только от его номера,
+/// поэтому результат не зависит от числа потоков.
+constexpr size_t GENERATION_CHUNK = 1 << 16;
+
+/// @brief Параллельно генерирует вектор объектов DataObject по профилю.
+/// Ключи строятся по номеру прямо в строке записи, без пула ключей и копирования строк;
+/// каждый фрагмент использует свой xoshiro256** с зерном, выведенным из seed и номера фрагмента.
+/// Перекос Ципфа воспроизводится приближенно (sampleZipfRank).
+/// @param size Количество объектов для генерации.
+/// @param profile Профиль набора данных.
+/// @param seed Зерно; при одинаковом seed результат одинаков.
+/// @param threads Число потоков; 0 - по числу аппаратных потоков.
+/// @return Вектор сгенерированных объектов DataObject.
+std::vector<DataObject> generateDataParallel(size_t size, const DataProfile& profile = DataProfile(),
+                                             uint64_t seed = 1, unsigned threads = 0) {
+    std::vector<DataObject> data(size);
+    if (size == 0) return data;
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+
+    const std::vector<std::string> prefixes = makeSyntheticPrefixes(profile, seed);
+    const uint64_t num_unique_keys = std::max<uint64_t>(10, static_cast<uint64_t>(size * profile.distinct_ratio));
+    const size_t chunkCount = (size + GENERATION_CHUNK - 1) / GENERATION_CHUNK;
+    std::atomic<size_t> nextChunk{0};
+
+    auto worker = [&]() {
+        for (size_t chunk; (chunk = nextChunk.fetch_add(1, std::memory_order_relaxed)) < chunkCount; ) {
+            Xoshiro256 rng(seed ^ (chunk * 0xD1B54A32D192ED03ULL));
+            size_t end = std::min(size, (chunk + 1) * GENERATION_CHUNK);
+            for (size_t i = chunk * GENERATION_CHUNK; i < end; ++i) {
+                uint64_t keyId = profile.zipf_exponent > 0.0
+                    ? sampleZipfRank(rng.unit(), num_unique_keys, profile.zipf_exponent)
+                    : rng.below(num_unique_keys);
+                DataObject& obj = data[i];
+                writeSyntheticKey(obj.key, keyId, profile, prefixes);
+                obj.value1 = static_cast<int>(1 + rng.below(1000));
+                obj.value2 = rng.unit() * 100.0;
+            }
+        }
+    };
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < threads; ++t) workers.emplace_back(worker);
+    worker();
+    for (auto& w : workers) w.join();
+    return data;
+}
+
+/// @brief Порождает size объектов потоком, передавая каждый в sink, без материализации вектора.
+/// Распределение совпадает с generateData: max(10, size / 5) различных ключей, равномерные дубликаты.
+/// @tparam Sink Тип функции void(const DataObject&).
+/// @param size Количество объектов.
+/// @param seed Зерно генератора.
+/// @param sink Получатель объектов.
+template <typename Sink>
+void generateDataStream(size_t size, uint64_t seed, Sink sink) {
+    Xoshiro256 rng(seed);
+    const DataProfile profile;
+    const std::vector<std::string> noPrefixes;
+    uint64_t num_unique_keys = std::max<uint64_t>(10, size / 5);
+    DataObject obj;
+    for (size_t i = 0; i < size; ++i) {
+        writeSyntheticKey(obj.key, rng.below(num_unique_keys), profile, noPrefixes);
+        obj.value1 = static_cast<int>(1 + rng.below(1000));
+        obj.value2 = rng.unit() * 100.0;
+        sink(obj);
+    }
+}
+
+
 /// @brief Выполняет линейный поиск всех объектов с заданным ключом в векторе.
 /// @param data Вектор объектов DataObject для поиска.
 /// @param searchKey Ключ, по которому осуществляется поиск.
 /// @return Вектор найденных объектов DataObject. Сложность O(N).
-std::vector<DataObject> linearSearch(const std::vector<DataObject>& data, const std::string& searchKey) {
+std::vector<DataObject> linearSearch(const std::vector<DataObject>& data, std::string_view searchKey) {
     std::vector<DataObject> results;
     for (const auto& obj : data) {
         if (obj.key == searchKey) {
@@ -123,89 +453,272 @@ std::vector<DataObject> linearSearch(const std::vector<DataObject>& data, const
     return results;
 }
 
+/// @brief Возвращает число байт, которое строка занимает в куче.
+/// @param s Строка.
+/// @return 0 для строк, помещающихся во внутренний SSO-буфер, иначе емкость плюс завершающий нуль.
+inline size_t stringHeapBytes(const std::string& s) {
+    static const size_t inline_capacity = std::string().capacity();
+    return s.capacity() > inline_capacity ? s.capacity() + 1 : 0;
+}
+
+/// @brief Оценивает размер узла std::list: элемент и два указателя (без служебных данных аллокатора).
+/// @tparam Entry Тип элемента списка.
+/// @return Размер в байтах.
+template <typename Entry>
+constexpr size_t listNodeBytes() {
+    return sizeof(Entry) + 2 * sizeof(void*);
+}
+
+
+/// @brief Запись общего вида для контейнеров с произвольным ключом: ключ и полезная нагрузка.
+/// Шаблонные BST, RBT и хеш-таблица принимают любую запись с полем key (DataObject или KeyValue).
+/// @tparam Key Тип ключа.
+/// @tparam Mapped Тип нагрузки.
+template <typename Key, typename Mapped>
+struct KeyValue {
+    Key key;
+    Mapped value;
+};
+
+/// @brief Тип ключа записи Value (тип ее поля key).
+template <typename Value>
+using RecordKey = decltype(Value::key);
+
+/// @brief Тип аргумента поиска по ключу Key: по умолчанию константная ссылка.
+template <typename Key, typename Enable = void>
+struct KeyLookup {
+    using type = const Key&;
+};
+
+/// @brief Целочисленные ключи передаются по значению, в регистре.
+template <typename Key>
+struct KeyLookup<Key, std::enable_if_t<std::is_integral_v<Key>>> {
+    using type = Key;
+};
+
+/// @brief Строковые ключи ищутся по std::string_view: запрос не требует создания std::string.
+template <>
+struct KeyLookup<std::string> {
+    using type = std::string_view;
+};
+
+template <typename Key>
+using LookupKey = typename KeyLookup<Key>::type;
+
+/// @brief Хеш ключа по умолчанию: std::hash.
+template <typename Key, typename Enable = void>
+struct KeyHash {
+    size_t operator()(const Key& key) const {
+        return std::hash<Key>{}(key);
+    }
+};
+
+/// @brief Хеш целочисленного ключа: умножение на 2^64 / phi и свертка старшей половины.
+/// Одно умножение без ветвлений и обращений к памяти, при этом последовательные идентификаторы
+/// (в отличие от тождественного std::hash) равномерно расходятся по корзинам.
+template <typename Key>
+struct KeyHash<Key, std::enable_if_t<std::is_integral_v<Key>>> {
+    size_t operator()(Key key) const {
+        uint64_t x = static_cast<uint64_t>(key) * 0x9E3779B97F4A7C15ULL;
+        return static_cast<size_t>(x ^ (x >> 32));
+    }
+};
+
+/// @brief Хеш строкового ключа. Значения std::hash<std::string_view> совпадают с std::hash<std::string>,
+/// поэтому ключ можно хешировать без создания std::string.
+template <>
+struct KeyHash<std::string> {
+    size_t operator()(std::string_view key) const {
+        return std::hash<std::string_view>{}(key);
+    }
+};
+
+
+/// @brief Политика учета работы поиска по умолчанию: методы пусты и после встраивания
+/// не оставляют в коде поиска ни одной инструкции.
+struct NoSearchStats {
+    void visitNode() {}
+    template <typename A, typename B>
+    void compareKeys(const A&, const B&) {}
+};
+
+/// @brief Политика учета работы поиска: посещенные узлы (элементы цепочки), сравнения ключей
+/// и сравненные байты. Передается в шаблонные перегрузки search для выбранных запросов.
+struct CountingSearchStats {
+    /// @brief Число посещенных узлов дерева или элементов цепочки.
+    size_t nodes_visited = 0;
+    /// @brief Число сравнений ключей.
+    size_t comparisons = 0;
+    /// @brief Число сравненных байтов: общий префикс плюс байт различия (не больше длины короткой строки).
+    size_t bytes_compared = 0;
+
+    void visitNode() {
+        ++nodes_visited;
+    }
+
+    void compareKeys(std::string_view a, std::string_view b) {
+        ++comparisons;
+        size_t limit = std::min(a.size(), b.size());
+        size_t common = 0;
+        while (common < limit && a[common] == b[common]) ++common;
+        bytes_compared += std::min(common + 1, limit);
+    }
+
+    /// @brief Сравнение целочисленных ключей: одна инструкция над sizeof(Key) байтами.
+    template <typename Key, typename = std::enable_if_t<std::is_integral_v<Key>>>
+    void compareKeys(Key, Key) {
+        ++comparisons;
+        bytes_compared += sizeof(Key);
+    }
+};
+
+/// @brief Форма дерева поиска.
+struct TreeShape {
+    /// @brief Высота (число узлов на самом длинном пути от корня).
+    size_t height = 0;
+    /// @brief Средняя глубина узла (корень на глубине 1).
+    double average_depth = 0.0;
+    /// @brief Черная высота (для красно-черного дерева; 0 для остальных).
+    size_t black_height = 0;
+};
+
+/// @brief Обходит дерево итеративно (глубина вырожденного BST может быть порядка N) и вычисляет его форму.
+/// @tparam Node Тип узла с полями left и right.
+/// @param root Корень дерева.
+/// @return Высота и средняя глубина; black_height не заполняется.
+template <typename Node>
+TreeShape measureTreeShape(const Node* root) {
+    TreeShape shape;
+    if (!root) return shape;
+    size_t nodes = 0;
+    double totalDepth = 0.0;
+    std::vector<std::pair<const Node*, size_t>> stack{{root, 1}};
+    while (!stack.empty()) {
+        auto [node, depth] = stack.back();
+        stack.pop_back();
+        ++nodes;
+        totalDepth += static_cast<double>(depth);
+        shape.height = std::max(shape.height, depth);
+        if (node->left) stack.push_back({node->left, depth + 1});
+        if (node->right) stack.push_back({node->right, depth + 1});
+    }
+    shape.average_depth = totalDepth / static_cast<double>(nodes);
+    return shape;
+}
+
 
 /// @brief Узел простого бинарного дерева поиска.
-struct BSTNode {
+/// @tparam Value Тип записи с полем key.
+template <typename Value>
+struct BasicBSTNode {
     /// @brief Данные, хранящиеся в узле.
-    DataObject data;
+    Value data;
     /// @brief Указатель на левого потомка.
-    BSTNode *left = nullptr;
+    BasicBSTNode *left = nullptr;
     /// @brief Указатель на правого потомка.
-    BSTNode *right = nullptr;
+    BasicBSTNode *right = nullptr;
 
     /// @brief Конструктор узла BST.
-    /// @param d Объект DataObject для хранения в узле.
-    BSTNode(DataObject d) : data(std::move(d)) {}
+    /// @param d Запись для хранения в узле.
+    BasicBSTNode(Value d) : data(std::move(d)) {}
 };
 
-/// @brief Рекурсивно вставляет объект в BST.
-/// @param node Ссылка на указатель на текущий узел (может измениться).
-/// @param obj Объект DataObject для вставки.
+/// @brief Узел BST со строковым ключом и объектом DataObject.
+using BSTNode = BasicBSTNode<DataObject>;
+
+/// @brief Вставляет объект в BST. Спуск итеративный: на наборах с длинными цепочками
+/// дубликатов (например, Zipf) глубина дерева порядка N и рекурсия переполнила бы стек.
+/// @tparam Compare Строгий порядок ключей (должен согласовываться с operator==).
+/// @tparam Value Тип записи с полем key.
+/// @param node Ссылка на указатель на корень (может измениться).
+/// @param obj Запись для вставки.
 /// @note Дубликаты ключей разрешены и вставляются в правое поддерево.
-void insertBST(BSTNode*& node, DataObject obj) {
-    if (node == nullptr) {
-        node = new BSTNode(std::move(obj));
-        return;
-    }
-    if (obj.key < node->data.key) {
-        insertBST(node->left, std::move(obj));
-    } else {
-        insertBST(node->right, std::move(obj));
+template <typename Compare = std::less<>, typename Value>
+void insertBST(BasicBSTNode<Value>*& node, Value obj) {
+    BasicBSTNode<Value>** link = &node;
+    while (*link != nullptr) {
+        link = Compare{}(obj.key, (*link)->data.key) ? &(*link)->left : &(*link)->right;
     }
+    *link = new BasicBSTNode<Value>(std::move(obj));
 }
 
-/// @brief Рекурсивно ищет все объекты с заданным ключом в BST.
-/// @param node Текущий узел для проверки.
+/// @brief Итеративно ищет все объекты с заданным ключом в BST.
+/// Дубликаты лежат в правом поддереве найденного узла, поэтому после совпадения спуск продолжается вправо.
+/// @param node Корень дерева.
 /// @param searchKey Ключ для поиска.
 /// @param results Вектор для накопления найденных объектов.
-void searchBSTRecursive(BSTNode* node, const std::string& searchKey, std::vector<DataObject>& results) {
-    if (node == nullptr) {
-        return;
+/// @param stats Счетчики работы (политика NoSearchStats или CountingSearchStats).
+template <typename Compare, typename Value, typename Stats>
+void searchBSTIterative(BasicBSTNode<Value>* node, LookupKey<RecordKey<Value>> searchKey,
+                        std::vector<Value>& results, Stats& stats) {
+    while (node != nullptr) {
+        stats.visitNode();
+        stats.compareKeys(searchKey, node->data.key);
+        if (searchKey == node->data.key) {
+            results.push_back(node->data);
+            node = node->right;
+            continue;
+        }
+        stats.compareKeys(searchKey, node->data.key);
+        node = Compare{}(searchKey, node->data.key) ? node->left : node->right;
     }
+}
 
-    if (searchKey == node->data.key) {
-        results.push_back(node->data);
-        searchBSTRecursive(node->right, searchKey, results);
-    } else if (searchKey < node->data.key) {
-        searchBSTRecursive(node->left, searchKey, results);
-    } else {
-        searchBSTRecursive(node->right, searchKey, results);
-    }
+/// @brief Функция-обертка для поиска всех вхождений ключа в BST с учетом работы поиска.
+/// @tparam Compare Строгий порядок ключей.
+/// @tparam Stats Политика учета работы.
+/// @param root Корневой узел BST.
+/// @param searchKey Ключ для поиска.
+/// @param stats Счетчики работы.
+/// @return Вектор найденных объектов.
+template <typename Compare = std::less<>, typename Value, typename Stats>
+std::vector<Value> searchBST(BasicBSTNode<Value>* root, LookupKey<RecordKey<Value>> searchKey, Stats& stats) {
+    std::vector<Value> results;
+    searchBSTIterative<Compare>(root, searchKey, results, stats);
+    return results;
 }
 
 /// @brief Функция-обертка для поиска всех вхождений ключа в BST.
+/// @tparam Compare Строгий порядок ключей.
 /// @param root Корневой узел BST.
 /// @param searchKey Ключ для поиска.
-/// @return Вектор найденных объектов DataObject. Сложность O(log N) в среднем, O(N) в худшем + O(k), где k - число найденных.
-std::vector<DataObject> searchBST(BSTNode* root, const std::string& searchKey) {
-    std::vector<DataObject> results;
-    searchBSTRecursive(root, searchKey, results);
-    return results;
+/// @return Вектор найденных объектов. Сложность O(log N) в среднем, O(N) в худшем + O(k), где k - число найденных.
+template <typename Compare = std::less<>, typename Value>
+std::vector<Value> searchBST(BasicBSTNode<Value>* root, LookupKey<RecordKey<Value>> searchKey) {
+    NoSearchStats stats;
+    return searchBST<Compare>(root, searchKey, stats);
 }
 
-/// @brief Рекурсивно удаляет узлы BST, освобождая память.
-/// @param node Узел для удаления.
-void destroyBST(BSTNode* node) {
-    if (node) {
-        destroyBST(node->left);
-        destroyBST(node->right);
-        delete node;
+/// @brief Удаляет узлы BST, освобождая память. Обход итеративный (см. insertBST).
+/// @param node Корень дерева.
+template <typename Value>
+void destroyBST(BasicBSTNode<Value>* node) {
+    std::vector<BasicBSTNode<Value>*> stack;
+    if (node) stack.push_back(node);
+    while (!stack.empty()) {
+        BasicBSTNode<Value>* current = stack.back();
+        stack.pop_back();
+        if (current->left) stack.push_back(current->left);
+        if (current->right) stack.push_back(current->right);
+        delete current;
     }
 }
 
 
 /// @brief Узел Красно-Черного Дерева.
-struct RBTNode {
+/// @tparam Value Тип записи с полем key.
+template <typename Value>
+struct BasicRBTNode {
     /// @brief Данные, хранящиеся в узле.
-    DataObject data;
+    Value data;
     /// @brief Цвет узла (RED или BLACK).
     Color color;
     /// @brief Указатель на родительский узел.
-    RBTNode *parent;
+    BasicRBTNode *parent;
     /// @brief Указатель на левого потомка.
-    RBTNode *left;
+    BasicRBTNode *left;
     /// @brief Указатель на правого потомка.
-    RBTNode *right;
+    BasicRBTNode *right;
 
     /// @brief Конструктор узла RBT.
     /// @param d Данные для узла.
@@ -213,7 +726,7 @@ struct RBTNode {
     /// @param p Родительский узел (по умолчанию nullptr).
     /// @param l Левый потомок (по умолчанию nullptr).
     /// @param r Правый потомок (по умолчанию nullptr).
-    RBTNode(DataObject d, Color c = RED, RBTNode* p = nullptr, RBTNode* l = nullptr, RBTNode* r = nullptr)
+    BasicRBTNode(Value d, Color c = RED, BasicRBTNode* p = nullptr, BasicRBTNode* l = nullptr, BasicRBTNode* r = nullptr)
         : data(std::move(d)), color(c), parent(p), left(l), right(r) {}
 
     /// @brief Проверяет, является ли узел левым потомком.
@@ -230,17 +743,39 @@ struct RBTNode {
 };
 
 
+/// @brief Узел RBT со строковым ключом и объектом DataObject.
+using RBTNode = BasicRBTNode<DataObject>;
+
+
 /// @brief Класс, реализующий Красно-Черное Дерево.
-class RedBlackTree {
+/// @tparam Key Тип ключа (тип поля key записи).
+/// @tparam Value Тип записи с полем key.
+/// @tparam Compare Строгий порядок ключей; должен согласовываться с operator== ключей.
+template <typename Key, typename Value, typename Compare = std::less<>>
+class BasicRedBlackTree {
+    static_assert(std::is_same_v<RecordKey<Value>, Key>, "Value::key должен иметь тип Key");
+
+public:
+    /// @brief Тип узла дерева.
+    using Node = BasicRBTNode<Value>;
+    /// @brief Тип аргумента поиска (std::string_view для строк, значение для целых).
+    using lookup_type = LookupKey<Key>;
+
 private:
     /// @brief Указатель на корневой узел дерева.
-    RBTNode* root;
+    Node* root;
+
+    /// @brief Сравнивает ключи порядком Compare.
+    template <typename A, typename B>
+    static bool less(const A& a, const B& b) {
+        return Compare{}(a, b);
+    }
 
     /// @brief Выполняет левый поворот вокруг узла x.
     /// @param x Узел, вокруг которого выполняется поворот.
     /// @pre Правый потомок x не должен быть nullptr.
-    void leftRotate(RBTNode* x) {
-        RBTNode* y = x->right;
+    void leftRotate(Node* x) {
+        Node* y = x->right;
         if (!y) return;
 
         x->right = y->left;
@@ -264,8 +799,8 @@ private:
     /// @brief Выполняет правый поворот вокруг узла y.
     /// @param y Узел, вокруг которого выполняется поворот.
     /// @pre Левый потомок y не должен быть nullptr.
-    void rightRotate(RBTNode* y) {
-        RBTNode* x = y->left;
+    void rightRotate(Node* y) {
+        Node* x = y->left;
         if (!x) return;
 
         y->left = x->right;
@@ -288,14 +823,14 @@ private:
 
     /// @brief Восстанавливает свойства Красно-Черного дерева после вставки узла.
     /// @param z Вставленный узел (изначально красный).
-    void insertFixup(RBTNode* z) {
+    void insertFixup(Node* z) {
         while (z->parent && z->parent->color == RED) {
-            RBTNode* parent = z->parent;
-            RBTNode* grandparent = parent->parent;
+            Node* parent = z->parent;
+            Node* grandparent = parent->parent;
             if (!grandparent) break;
 
             if (parent == grandparent->left) {
-                RBTNode* uncle = grandparent->right;
+                Node* uncle = grandparent->right;
                 if (uncle && uncle->color == RED) {
                     parent->color = BLACK;
                     uncle->color = BLACK;
@@ -316,7 +851,7 @@ private:
                     }
                 }
             } else {
-                RBTNode* uncle = grandparent->left;
+                Node* uncle = grandparent->left;
                 if (uncle && uncle->color == RED) {
                     parent->color = BLACK;
                     uncle->color = BLACK;
@@ -344,25 +879,35 @@ private:
     /// @param node Текущий узел для проверки.
     /// @param searchKey Ключ для поиска.
     /// @param results Вектор для накопления найденных объектов.
-    void searchRecursive(RBTNode* node, const std::string& searchKey, std::vector<DataObject>& results) const {
+    /// @param stats Счетчики работы (политика NoSearchStats или CountingSearchStats).
+    /// @note После поворотов равные ключи могут оказаться в обоих поддеревьях узла,
+    /// поэтому при совпадении спуск продолжается в обе стороны.
+    template <typename Stats>
+    void searchRecursive(Node* node, lookup_type searchKey, std::vector<Value>& results, Stats& stats) const {
         if (node == nullptr) {
             return;
         }
 
+        stats.visitNode();
+        stats.compareKeys(searchKey, node->data.key);
         if (searchKey == node->data.key) {
+            searchRecursive(node->left, searchKey, results, stats);
             results.push_back(node->data);
-            searchRecursive(node->right, searchKey, results);
-        } else if (searchKey < node->data.key) {
-            searchRecursive(node->left, searchKey, results);
+            searchRecursive(node->right, searchKey, results, stats);
+            return;
+        }
+        stats.compareKeys(searchKey, node->data.key);
+        if (less(searchKey, node->data.key)) {
+            searchRecursive(node->left, searchKey, results, stats);
         } else {
-            searchRecursive(node->right, searchKey, results);
+            searchRecursive(node->right, searchKey, results, stats);
         }
     }
 
 
     /// @brief Рекурсивно удаляет узлы дерева, освобождая память.
     /// @param node Узел для удаления.
-    void destroyRecursive(RBTNode* node) {
+    void destroyRecursive(Node* node) {
         if (node) {
             destroyRecursive(node->left);
             destroyRecursive(node->right);
@@ -370,25 +915,240 @@ private:
         }
     }
 
+    /// @brief Находит узел с минимальным ключом в поддереве.
+    /// @param node Корень поддерева (может быть nullptr).
+    /// @return Самый левый узел поддерева или nullptr.
+    static const Node* minimum(const Node* node) {
+        if (!node) return nullptr;
+        while (node->left) {
+            node = node->left;
+        }
+        return node;
+    }
+
+    /// @brief Проверяет, является ли узел черным (пустые листья nullptr считаются черными).
+    /// @param node Узел для проверки.
+    /// @return true, если узел черный или отсутствует.
+    static bool isBlack(const Node* node) {
+        return node == nullptr || node->color == BLACK;
+    }
+
+    /// @brief Заменяет поддерево с корнем u поддеревом с корнем v в родителе u.
+    /// @param u Заменяемый узел.
+    /// @param v Узел-замена (может быть nullptr).
+    void transplant(Node* u, Node* v) {
+        if (!u->parent) {
+            root = v;
+        } else if (u == u->parent->left) {
+            u->parent->left = v;
+        } else {
+            u->parent->right = v;
+        }
+        if (v) {
+            v->parent = u->parent;
+        }
+    }
+
+    /// @brief Восстанавливает свойства Красно-Черного дерева после удаления черного узла.
+    /// @param x Узел, занявший место удаленного (может быть nullptr).
+    /// @param xParent Родитель x (нужен, так как x может быть nullptr).
+    void eraseFixup(Node* x, Node* xParent) {
+        while (x != root && isBlack(x)) {
+            if (x == xParent->left) {
+                Node* w = xParent->right;
+                if (w->color == RED) {
+                    w->color = BLACK;
+                    xParent->color = RED;
+                    leftRotate(xParent);
+                    w = xParent->right;
+                }
+                if (isBlack(w->left) && isBlack(w->right)) {
+                    w->color = RED;
+                    x = xParent;
+                    xParent = x->parent;
+                } else {
+                    if (isBlack(w->right)) {
+                        w->left->color = BLACK;
+                        w->color = RED;
+                        rightRotate(w);
+                        w = xParent->right;
+                    }
+                    w->color = xParent->color;
+                    xParent->color = BLACK;
+                    if (w->right) w->right->color = BLACK;
+                    leftRotate(xParent);
+                    x = root;
+                }
+            } else {
+                Node* w = xParent->left;
+                if (w->color == RED) {
+                    w->color = BLACK;
+                    xParent->color = RED;
+                    rightRotate(xParent);
+                    w = xParent->left;
+                }
+                if (isBlack(w->left) && isBlack(w->right)) {
+                    w->color = RED;
+                    x = xParent;
+                    xParent = x->parent;
+                } else {
+                    if (isBlack(w->left)) {
+                        w->right->color = BLACK;
+                        w->color = RED;
+                        leftRotate(w);
+                        w = xParent->left;
+                    }
+                    w->color = xParent->color;
+                    xParent->color = BLACK;
+                    if (w->left) w->left->color = BLACK;
+                    rightRotate(xParent);
+                    x = root;
+                }
+            }
+        }
+        if (x) x->color = BLACK;
+    }
+
+    /// @brief Удаляет узел из дерева и освобождает его память.
+    /// Узлы перевешиваются, а не копируются, поэтому указатели на остальные узлы остаются действительными.
+    /// @param z Удаляемый узел.
+    void eraseNode(Node* z) {
+        Node* y = z;
+        Color yOriginalColor = y->color;
+        Node* x = nullptr;
+        Node* xParent = nullptr;
+
+        if (!z->left) {
+            x = z->right;
+            xParent = z->parent;
+            transplant(z, z->right);
+        } else if (!z->right) {
+            x = z->left;
+            xParent = z->parent;
+            transplant(z, z->left);
+        } else {
+            y = z->right;
+            while (y->left) {
+                y = y->left;
+            }
+            yOriginalColor = y->color;
+            x = y->right;
+            if (y->parent == z) {
+                xParent = y;
+            } else {
+                xParent = y->parent;
+                transplant(y, y->right);
+                y->right = z->right;
+                y->right->parent = y;
+            }
+            transplant(z, y);
+            y->left = z->left;
+            y->left->parent = y;
+            y->color = z->color;
+        }
+        delete z;
+
+        if (yOriginalColor == BLACK) {
+            eraseFixup(x, xParent);
+        }
+    }
+
+    /// @brief Находит первый узел с ключом, не меньшим key.
+    /// @param key Граница поиска.
+    /// @return Найденный узел или nullptr.
+    Node* lowerBoundNode(lookup_type key) const {
+        Node* x = root;
+        Node* result = nullptr;
+        while (x) {
+            if (less(x->data.key, key)) {
+                x = x->right;
+            } else {
+                result = x;
+                x = x->left;
+            }
+        }
+        return result;
+    }
+
+    /// @brief Находит следующий узел в порядке обхода in-order, используя ссылки на родителя.
+    /// @param node Текущий узел.
+    /// @return Следующий узел или nullptr, если node - последний.
+    static const Node* successor(const Node* node) {
+        if (node->right) {
+            return minimum(node->right);
+        }
+        while (node->isRightChild()) {
+            node = node->parent;
+        }
+        return node->parent;
+    }
+
 public:
+    /// @brief Итератор обхода RBT в порядке возрастания ключей.
+    /// Не требует рекурсии и стека: переход к следующему узлу идет по ссылкам на родителя.
+    class const_iterator {
+    private:
+        /// @brief Текущий узел (nullptr соответствует end()).
+        const Node* node;
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Value;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Value*;
+        using reference = const Value&;
+
+        /// @brief Конструктор итератора.
+        /// @param n Узел, на который указывает итератор.
+        explicit const_iterator(const Node* n = nullptr) : node(n) {}
+
+        reference operator*() const { return node->data; }
+        pointer operator->() const { return &node->data; }
+
+        /// @brief Переходит к следующему по порядку объекту. Амортизированно O(1).
+        const_iterator& operator++() {
+            node = successor(node);
+            return *this;
+        }
+
+        const_iterator operator++(int) {
+            const_iterator prev = *this;
+            node = successor(node);
+            return prev;
+        }
+
+        bool operator==(const const_iterator& other) const { return node == other.node; }
+        bool operator!=(const const_iterator& other) const { return node != other.node; }
+    };
+
+    /// @brief Полуинтервал [first, last) итераторов, пригодный для range-based for.
+    struct Range {
+        const_iterator first;
+        const_iterator last;
+
+        const_iterator begin() const { return first; }
+        const_iterator end() const { return last; }
+        bool empty() const { return first == last; }
+    };
+
     /// @brief Конструктор RBT. Инициализирует дерево пустым.
-    RedBlackTree() : root(nullptr) {}
+    BasicRedBlackTree() : root(nullptr) {}
 
     /// @brief Деструктор RBT. Освобождает всю память, занятую узлами.
-    ~RedBlackTree() {
+    ~BasicRedBlackTree() {
         destroyRecursive(root);
     }
 
-    /// @brief Вставляет новый объект DataObject в Красно-Черное дерево.
+    /// @brief Вставляет новую запись в Красно-Черное дерево.
     /// @param obj Объект для вставки. Сложность O(log N).
-    void insert(DataObject obj) {
-        RBTNode* z = new RBTNode(std::move(obj));
-        RBTNode* y = nullptr;
-        RBTNode* x = root;
+    void insert(Value obj) {
+        Node* z = new Node(std::move(obj));
+        Node* y = nullptr;
+        Node* x = root;
 
         while (x) {
             y = x;
-            if (z->data.key < x->data.key) {
+            if (less(z->data.key, x->data.key)) {
                 x = x->left;
             } else {
                 x = x->right;
@@ -398,7 +1158,7 @@ public:
         z->parent = y;
         if (!y) {
             root = z;
-        } else if (z->data.key < y->data.key) {
+        } else if (less(z->data.key, y->data.key)) {
             y->left = z;
         } else {
             y->right = z;
@@ -410,158 +1170,5009 @@ public:
 
     /// @brief Ищет все объекты с заданным ключом в RBT.
     /// @param searchKey Ключ для поиска.
-    /// @return Вектор найденных объектов DataObject. Сложность O(log N + k), где k - число найденных.
-    std::vector<DataObject> search(const std::string& searchKey) const {
-        std::vector<DataObject> results;
-        searchRecursive(root, searchKey, results);
+    /// @return Вектор найденных записей. Сложность O(log N + k), где k - число найденных.
+    std::vector<Value> search(lookup_type searchKey) const {
+        NoSearchStats stats;
+        return search(searchKey, stats);
+    }
+
+    /// @brief Ищет все объекты с заданным ключом в RBT с учетом работы поиска.
+    /// @tparam Stats Политика учета работы.
+    /// @param searchKey Ключ для поиска.
+    /// @param stats Счетчики работы.
+    /// @return Вектор найденных записей.
+    template <typename Stats>
+    std::vector<Value> search(lookup_type searchKey, Stats& stats) const {
+        std::vector<Value> results;
+        searchRecursive(root, searchKey, results, stats);
         return results;
     }
 
-    /// @brief Строит RBT из существующего вектора данных.
-    /// @param data Вектор объектов DataObject.
-    void build(const std::vector<DataObject>& data) {
-        destroyRecursive(root);
-        root = nullptr;
-        for(const auto& obj : data) {
-            insert(obj);
+    /// @brief Возвращает форму дерева: высоту, среднюю глубину и черную высоту.
+    /// @return Форма дерева; черная высота считается по пути к самому левому узлу.
+    TreeShape shape() const {
+        TreeShape result = measureTreeShape(static_cast<const Node*>(root));
+        for (const Node* node = root; node; node = node->left) {
+            if (node->color == BLACK) ++result.black_height;
         }
+        return result;
     }
-};
 
+    /// @brief Удаляет все объекты с заданным ключом.
+    /// @param key Ключ удаляемых объектов.
+    /// @return Количество удаленных объектов. Сложность O((k + 1) log N).
+    size_t erase(lookup_type key) {
+        size_t removed = 0;
+        Node* node = lowerBoundNode(key);
+        while (node && node->data.key == key) {
+            Node* next = const_cast<Node*>(successor(node));
+            eraseNode(node);
+            node = next;
+            ++removed;
+        }
+        return removed;
+    }
 
-/// @brief Класс, реализующий хеш-таблицу с методом цепочек для разрешения коллизий.
-class HashTable {
-private:
-    /// @brief Основное хранилище хеш-таблицы: вектор списков (цепочек).
-    std::vector<std::list<DataObject>> table;
-    /// @brief Текущий размер вектора table (количество "корзин").
-    size_t table_size;
-    /// @brief Счетчик коллизий, возникших при вставке.
-    size_t collision_count;
+    /// @brief Удаляет первый объект с заданным ключом, удовлетворяющий предикату.
+    /// @tparam Predicate Тип предиката bool(const Value&).
+    /// @param key Ключ удаляемого объекта.
+    /// @param pred Предикат отбора среди объектов с ключом key.
+    /// @return true, если объект был найден и удален. Сложность O(log N + k).
+    template <typename Predicate>
+    bool eraseOne(lookup_type key, Predicate pred) {
+        for (Node* node = lowerBoundNode(key); node && node->data.key == key;
+             node = const_cast<Node*>(successor(node))) {
+            if (pred(static_cast<const Value&>(node->data))) {
+                eraseNode(node);
+                return true;
+            }
+        }
+        return false;
+    }
 
-    /// @brief Хеш-функция для ключа (строки).
-    /// Использует стандартную std::hash<std::string>.
-    /// @param key Строковый ключ для хеширования.
-    /// @return Хеш-индекс в диапазоне [0, table_size - 1].
-    size_t hashFunction(const std::string& key) const {
-        return table_size > 0 ? (std::hash<std::string>{}(key) % table_size) : 0;
+    /// @brief Изменяет на месте все объекты с заданным ключом.
+    /// @tparam Mutator Тип функции void(Value&).
+    /// @param key Ключ изменяемых объектов.
+    /// @param mutate Функция изменения; не должна менять ключ объекта.
+    /// @return Количество измененных объектов. Сложность O(log N + k).
+    template <typename Mutator>
+    size_t update(lookup_type key, Mutator mutate) {
+        size_t updated = 0;
+        for (Node* node = lowerBoundNode(key); node && node->data.key == key;
+             node = const_cast<Node*>(successor(node))) {
+            mutate(node->data);
+            ++updated;
+        }
+        return updated;
     }
 
-    /// @brief Проверяет, является ли число простым.
-    /// @param n Число для проверки.
-    /// @return true, если n простое, иначе false.
-    bool isPrime(size_t n) const {
-        if (n <= 1) return false;
-        if (n <= 3) return true;
-        if (n % 2 == 0 || n % 3 == 0) return false;
-        for (size_t i = 5; i * i <= n; i = i + 6) {
-            if (n % i == 0 || n % (i + 2) == 0) return false;
+    /// @brief Заменяет первый объект с ключом obj.key или вставляет obj, если такого ключа нет.
+    /// @param obj Новое значение объекта.
+    /// @return true, если объект был вставлен, false - если заменен существующий.
+    bool upsert(const Value& obj) {
+        Node* node = lowerBoundNode(obj.key);
+        if (node && node->data.key == obj.key) {
+            node->data = obj;
+            return false;
         }
+        insert(obj);
         return true;
     }
 
-    /// @brief Находит следующее простое число, не меньшее n.
-    /// Используется для выбора оптимального размера хеш-таблицы.
-    /// @param n Начальное число.
-    /// @return Ближайшее простое число >= n.
-    size_t findNextPrime(size_t n) const {
-        if (n <= 2) return 2;
-        n = static_cast<size_t>(static_cast<double>(n) * 1.5);
-        if (n % 2 == 0) n++;
-        while (!isPrime(n)) {
-            n += 2;
-        }
-        return n;
+    /// @brief Возвращает корневой узел (только для чтения), например для сериализации формы дерева.
+    const Node* rootNode() const {
+        return root;
     }
 
+    /// @brief Итератор на объект с минимальным ключом.
+    const_iterator begin() const {
+        return const_iterator(minimum(root));
+    }
 
-public:
-    /// @brief Конструктор хеш-таблицы.
-    /// @param expected_elements Ожидаемое количество элементов (для выбора размера таблицы).
-    HashTable(size_t expected_elements) : collision_count(0) {
-        table_size = findNextPrime(std::max(static_cast<size_t>(1), expected_elements));
-        table.resize(table_size);
+    /// @brief Итератор за последним объектом.
+    const_iterator end() const {
+        return const_iterator(nullptr);
     }
 
-    /// @brief Вставляет объект DataObject в хеш-таблицу.
-    /// @param obj Объект для вставки. Сложность в среднем O(1), в худшем O(N).
-    void insert(const DataObject& obj) {
-        if (table_size == 0) {
-             *this = HashTable(1);
+    /// @brief Находит первый объект с ключом, не меньшим key.
+    /// @param key Граница поиска.
+    /// @return Итератор на найденный объект или end(). Сложность O(log N).
+    const_iterator lowerBound(lookup_type key) const {
+        return const_iterator(lowerBoundNode(key));
+    }
+
+    /// @brief Находит первый объект с ключом, строго большим key.
+    /// @param key Граница поиска.
+    /// @return Итератор на найденный объект или end(). Сложность O(log N).
+    const_iterator upperBound(lookup_type key) const {
+        const Node* x = root;
+        const Node* result = nullptr;
+        while (x) {
+            if (less(key, x->data.key)) {
+                result = x;
+                x = x->left;
+            } else {
+                x = x->right;
+            }
         }
+        return const_iterator(result);
+    }
 
-        size_t index = hashFunction(obj.key);
+    /// @brief Возвращает все объекты с ключами из отрезка [lo, hi] без копирования.
+    /// @param lo Нижняя граница (включительно).
+    /// @param hi Верхняя граница (включительно).
+    /// @return Диапазон итераторов. Сложность O(log N + k), где k - число объектов в диапазоне.
+    Range rangeSearch(lookup_type lo, lookup_type hi) const {
+        if (less(hi, lo)) return Range{end(), end()};
+        return Range{lowerBound(lo), upperBound(hi)};
+    }
 
-        if (index >= table_size) {
-            std::cerr << "Ошибка хеш-функции: Индекс " << index << " вне диапазона [0, " << table_size - 1 << "]" << std::endl;
+    /// @brief Возвращает все объекты, ключ которых начинается с заданного префикса, без копирования.
+    /// Доступно только для строковых ключей.
+    /// @param prefix Префикс ключа.
+    /// @return Диапазон итераторов. Сложность O(log N + k), где k - число найденных.
+    Range prefixSearch(std::string_view prefix) const {
+        // Верхняя граница - наименьшая строка, большая всех строк с данным префиксом:
+        // отбрасываем завершающие байты 0xFF и увеличиваем последний оставшийся.
+        std::string bound(prefix);
+        while (!bound.empty() && static_cast<unsigned char>(bound.back()) == 0xFF) {
+            bound.pop_back();
+        }
+        if (bound.empty()) {
+            return Range{lowerBound(prefix), end()};
+        }
+        bound.back() = static_cast<char>(static_cast<unsigned char>(bound.back()) + 1);
+        return Range{lowerBound(prefix), lowerBound(bound)};
+    }
+
+    /// @brief Строит RBT из существующего вектора данных.
+    /// @param data Вектор записей.
+    void build(const std::vector<Value>& data) {
+        destroyRecursive(root);
+        root = nullptr;
+        for(const auto& obj : data) {
+            insert(obj);
+        }
+    }
+};
+
+/// @brief Красно-черное дерево со строковым ключом и объектами DataObject.
+using RedBlackTree = BasicRedBlackTree<std::string, DataObject>;
+
+
+/// @brief Компактный узел Красно-Черного дерева: ключ, номер строки исходного вектора
+/// и 32-битные индексы соседей в массиве узлов. Цвет хранится в младшем бите ссылки на родителя.
+/// Полезная нагрузка в узел не копируется и читается из исходного вектора по номеру строки.
+/// @tparam Key Тип хранимого ключа (std::string_view на ключ исходной записи или целое значение).
+/// @note Номер строки занимает место, которое иначе ушло бы на выравнивание:
+/// для uint64_t и std::string_view узел без него имеет тот же размер.
+template <typename Key>
+struct CompactRBTNode {
+    /// @brief Индекс, обозначающий отсутствующий узел.
+    static constexpr uint32_t NIL = UINT32_MAX;
+
+    /// @brief Ключ записи.
+    Key key;
+    /// @brief Номер строки в исходном векторе.
+    uint32_t row;
+    /// @brief Индекс левого потомка.
+    uint32_t left = NIL;
+    /// @brief Индекс правого потомка.
+    uint32_t right = NIL;
+    /// @brief Индекс родителя, сдвинутый на один бит влево; младший бит - цвет (1 - красный).
+    uint32_t parent_color = (NIL << 1) | 1u;
+
+    /// @brief Конструктор красного узла без родителя и потомков.
+    /// @param k Ключ.
+    /// @param r Номер строки.
+    CompactRBTNode(Key k, uint32_t r) : key(k), row(r) {}
+
+    /// @brief Индекс родителя (NIL для корня).
+    uint32_t parent() const {
+        uint32_t index = parent_color >> 1;
+        return index == (NIL >> 1) ? NIL : index;
+    }
+
+    /// @brief Является ли узел красным.
+    bool isRed() const {
+        return (parent_color & 1u) != 0;
+    }
+
+    /// @brief Заменяет родителя, сохраняя цвет.
+    void setParent(uint32_t index) {
+        parent_color = ((index == NIL ? NIL >> 1 : index) << 1) | (parent_color & 1u);
+    }
+
+    /// @brief Задает цвет узла.
+    void setColor(Color c) {
+        parent_color = (parent_color & ~1u) | (c == RED ? 1u : 0u);
+    }
+};
+
+
+/// @brief Красно-Черное дерево с компактными узлами в одном массиве. Хранит только ключ
+/// и номер строки; записи остаются в исходном векторе и копируются лишь в результаты поиска.
+/// Поддерживает построение и поиск; исходный вектор должен жить и не меняться, пока используется дерево.
+/// @tparam Key Тип ключа (тип поля key записи).
+/// @tparam Value Тип записи с полем key.
+/// @tparam Compare Строгий порядок ключей; должен согласовываться с operator== ключей.
+template <typename Key, typename Value, typename Compare = std::less<>>
+class CompactRedBlackTree {
+    static_assert(std::is_same_v<RecordKey<Value>, Key>, "Value::key должен иметь тип Key");
+
+public:
+    /// @brief Тип аргумента поиска (std::string_view для строк, значение для целых).
+    using lookup_type = LookupKey<Key>;
+    /// @brief Тип узла дерева: строковый ключ хранится как std::string_view на ключ исходной записи.
+    using Node = CompactRBTNode<lookup_type>;
+    /// @brief Максимальное число узлов: на индекс родителя остается 31 бит, одно значение занято под NIL.
+    static constexpr size_t MAX_NODES = Node::NIL >> 1;
+
+private:
+    static constexpr uint32_t NIL = Node::NIL;
+
+    /// @brief Исходный вектор записей.
+    const std::vector<Value>* rows = nullptr;
+    /// @brief Массив узлов.
+    std::vector<Node> nodes;
+    /// @brief Индекс корня.
+    uint32_t root = NIL;
+
+    /// @brief Сравнивает ключи порядком Compare.
+    template <typename A, typename B>
+    static bool less(const A& a, const B& b) {
+        return Compare{}(a, b);
+    }
+
+    /// @brief Является ли узел красным (NIL считается черным).
+    bool isRed(uint32_t index) const {
+        return index != NIL && nodes[index].isRed();
+    }
+
+    /// @brief Выполняет левый поворот вокруг узла x.
+    /// @param x Индекс узла; его правый потомок не должен быть NIL.
+    void leftRotate(uint32_t x) {
+        uint32_t y = nodes[x].right;
+        uint32_t parent = nodes[x].parent();
+
+        nodes[x].right = nodes[y].left;
+        if (nodes[y].left != NIL) nodes[nodes[y].left].setParent(x);
+
+        nodes[y].setParent(parent);
+        if (parent == NIL) {
+            root = y;
+        } else if (x == nodes[parent].left) {
+            nodes[parent].left = y;
+        } else {
+            nodes[parent].right = y;
+        }
+
+        nodes[y].left = x;
+        nodes[x].setParent(y);
+    }
+
+    /// @brief Выполняет правый поворот вокруг узла y.
+    /// @param y Индекс узла; его левый потомок не должен быть NIL.
+    void rightRotate(uint32_t y) {
+        uint32_t x = nodes[y].left;
+        uint32_t parent = nodes[y].parent();
+
+        nodes[y].left = nodes[x].right;
+        if (nodes[x].right != NIL) nodes[nodes[x].right].setParent(y);
+
+        nodes[x].setParent(parent);
+        if (parent == NIL) {
+            root = x;
+        } else if (y == nodes[parent].left) {
+            nodes[parent].left = x;
+        } else {
+            nodes[parent].right = x;
+        }
+
+        nodes[x].right = y;
+        nodes[y].setParent(x);
+    }
+
+    /// @brief Восстанавливает свойства Красно-Черного дерева после вставки узла.
+    /// @param z Индекс вставленного (красного) узла.
+    void insertFixup(uint32_t z) {
+        while (isRed(nodes[z].parent())) {
+            uint32_t parent = nodes[z].parent();
+            uint32_t grandparent = nodes[parent].parent();
+
+            if (parent == nodes[grandparent].left) {
+                uint32_t uncle = nodes[grandparent].right;
+                if (isRed(uncle)) {
+                    nodes[parent].setColor(BLACK);
+                    nodes[uncle].setColor(BLACK);
+                    nodes[grandparent].setColor(RED);
+                    z = grandparent;
+                } else {
+                    if (z == nodes[parent].right) {
+                        z = parent;
+                        leftRotate(z);
+                        parent = nodes[z].parent();
+                    }
+                    nodes[parent].setColor(BLACK);
+                    nodes[grandparent].setColor(RED);
+                    rightRotate(grandparent);
+                }
+            } else {
+                uint32_t uncle = nodes[grandparent].left;
+                if (isRed(uncle)) {
+                    nodes[parent].setColor(BLACK);
+                    nodes[uncle].setColor(BLACK);
+                    nodes[grandparent].setColor(RED);
+                    z = grandparent;
+                } else {
+                    if (z == nodes[parent].left) {
+                        z = parent;
+                        rightRotate(z);
+                        parent = nodes[z].parent();
+                    }
+                    nodes[parent].setColor(BLACK);
+                    nodes[grandparent].setColor(RED);
+                    leftRotate(grandparent);
+                }
+            }
+        }
+        nodes[root].setColor(BLACK);
+    }
+
+    /// @brief Рекурсивно собирает номера строк всех узлов с заданным ключом.
+    /// @param index Индекс текущего узла.
+    /// @param searchKey Ключ для поиска.
+    /// @param results Вектор для накопления номеров строк.
+    /// @param stats Счетчики работы (политика NoSearchStats или CountingSearchStats).
+    /// @note Как и в BasicRedBlackTree, при совпадении спуск продолжается в обе стороны.
+    template <typename Stats>
+    void searchRecursive(uint32_t index, lookup_type searchKey, std::vector<uint32_t>& results, Stats& stats) const {
+        if (index == NIL) {
+            return;
+        }
+
+        const Node& node = nodes[index];
+        stats.visitNode();
+        stats.compareKeys(searchKey, node.key);
+        if (searchKey == node.key) {
+            searchRecursive(node.left, searchKey, results, stats);
+            results.push_back(node.row);
+            searchRecursive(node.right, searchKey, results, stats);
             return;
         }
+        stats.compareKeys(searchKey, node.key);
+        if (less(searchKey, node.key)) {
+            searchRecursive(node.left, searchKey, results, stats);
+        } else {
+            searchRecursive(node.right, searchKey, results, stats);
+        }
+    }
 
+    /// @brief Вставляет строку исходного вектора в дерево.
+    /// @param row Номер строки.
+    void insertRow(uint32_t row) {
+        uint32_t z = static_cast<uint32_t>(nodes.size());
+        nodes.emplace_back(lookup_type((*rows)[row].key), row);
+        uint32_t y = NIL;
+        uint32_t x = root;
 
-        if (!table[index].empty()) {
-             bool key_already_present_in_bucket = false;
-             for(const auto& existing_obj : table[index]) {
-                 if (existing_obj.key == obj.key) {
-                     key_already_present_in_bucket = true;
-                     break;
-                 }
-             }
-             if (!key_already_present_in_bucket) {
-                 collision_count++;
-             }
+        while (x != NIL) {
+            y = x;
+            x = less(nodes[z].key, nodes[x].key) ? nodes[x].left : nodes[x].right;
+        }
+
+        nodes[z].setParent(y);
+        if (y == NIL) {
+            root = z;
+        } else if (less(nodes[z].key, nodes[y].key)) {
+            nodes[y].left = z;
+        } else {
+            nodes[y].right = z;
+        }
+
+        insertFixup(z);
+    }
+
+public:
+    /// @brief Строит дерево по вектору записей. Записи не копируются: узлы ссылаются на строки data.
+    /// @param data Вектор записей; должен пережить дерево и не изменяться.
+    /// @return false, если записей больше MAX_NODES (дерево остается пустым).
+    bool build(const std::vector<Value>& data) {
+        nodes.clear();
+        root = NIL;
+        rows = &data;
+        if (data.size() > MAX_NODES) {
+            std::cerr << "Компактное RBT: слишком много записей (" << data.size() << ")" << std::endl;
+            return false;
+        }
+        nodes.reserve(data.size());
+        for (size_t row = 0; row < data.size(); ++row) {
+            insertRow(static_cast<uint32_t>(row));
+        }
+        return true;
+    }
+
+    /// @brief Ищет номера строк всех записей с заданным ключом, не копируя записи.
+    /// @param searchKey Ключ для поиска.
+    /// @return Номера строк исходного вектора.
+    std::vector<uint32_t> searchRows(lookup_type searchKey) const {
+        NoSearchStats stats;
+        std::vector<uint32_t> results;
+        searchRecursive(root, searchKey, results, stats);
+        return results;
+    }
+
+    /// @brief Ищет все объекты с заданным ключом.
+    /// @param searchKey Ключ для поиска.
+    /// @return Копии найденных записей из исходного вектора.
+    std::vector<Value> search(lookup_type searchKey) const {
+        NoSearchStats stats;
+        return search(searchKey, stats);
+    }
+
+    /// @brief Ищет все объекты с заданным ключом с учетом работы поиска.
+    /// @tparam Stats Политика учета работы.
+    /// @param searchKey Ключ для поиска.
+    /// @param stats Счетчики работы.
+    /// @return Копии найденных записей из исходного вектора.
+    template <typename Stats>
+    std::vector<Value> search(lookup_type searchKey, Stats& stats) const {
+        std::vector<uint32_t> found;
+        searchRecursive(root, searchKey, found, stats);
+        std::vector<Value> results;
+        results.reserve(found.size());
+        for (uint32_t row : found) results.push_back((*rows)[row]);
+        return results;
+    }
+
+    /// @brief Возвращает форму дерева: высоту, среднюю глубину и черную высоту.
+    /// @return Форма дерева; черная высота считается по пути к самому левому узлу.
+    TreeShape shape() const {
+        TreeShape result;
+        if (root == NIL) return result;
+        double totalDepth = 0.0;
+        std::vector<std::pair<uint32_t, size_t>> stack{{root, 1}};
+        while (!stack.empty()) {
+            auto [index, depth] = stack.back();
+            stack.pop_back();
+            totalDepth += static_cast<double>(depth);
+            result.height = std::max(result.height, depth);
+            if (nodes[index].left != NIL) stack.push_back({nodes[index].left, depth + 1});
+            if (nodes[index].right != NIL) stack.push_back({nodes[index].right, depth + 1});
+        }
+        result.average_depth = totalDepth / static_cast<double>(nodes.size());
+        for (uint32_t index = root; index != NIL; index = nodes[index].left) {
+            if (!nodes[index].isRed()) ++result.black_height;
+        }
+        return result;
+    }
+
+    /// @brief Число узлов дерева.
+    size_t size() const {
+        return nodes.size();
+    }
+
+    /// @brief Оценивает память массива узлов (ключи и записи принадлежат исходному вектору).
+    /// @return Размер в байтах.
+    size_t memoryUsage() const {
+        return nodes.capacity() * sizeof(Node);
+    }
+};
+
+
+/// @brief Неизменяемый узел персистентного Красно-Черного дерева.
+/// Узлы разделяются между версиями дерева и освобождаются по счетчику ссылок.
+struct PRBNode {
+    /// @brief Данные, хранящиеся в узле.
+    DataObject data;
+    /// @brief Цвет узла.
+    Color color;
+    /// @brief Левый потомок (узел-владелец удерживает на него ссылку).
+    const PRBNode* left;
+    /// @brief Правый потомок (узел-владелец удерживает на него ссылку).
+    const PRBNode* right;
+    /// @brief Число ссылок на узел из родителей и корней версий.
+    mutable std::atomic<uint32_t> refs;
+
+    /// @brief Число существующих узлов всех версий (для оценки расхода памяти).
+    static std::atomic<size_t> live_nodes;
+
+    PRBNode(Color c, const PRBNode* l, const DataObject& d, const PRBNode* r)
+        : data(d), color(c), left(l), right(r), refs(1) {
+        live_nodes.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    ~PRBNode() {
+        live_nodes.fetch_sub(1, std::memory_order_relaxed);
+    }
+};
+
+std::atomic<size_t> PRBNode::live_nodes{0};
+
+
+/// @brief Персистентное Красно-Черное дерево с копированием пути.
+/// Вставка не изменяет существующие узлы: копируются O(log N) узлов на пути от корня,
+/// остальные поддеревья разделяются с предыдущей версией. Каждая версия остается доступной
+/// для чтения, пока на нее есть ссылка, и может читаться из любых потоков без блокировок.
+/// @note Балансировка выполняется по схеме Окасаки (четыре случая красно-красного нарушения).
+class PersistentRedBlackTree {
+private:
+    /// @brief Корень версии (ссылка принадлежит этому объекту).
+    const PRBNode* root;
+
+    /// @brief Увеличивает счетчик ссылок узла.
+    static const PRBNode* retain(const PRBNode* node) {
+        if (node) node->refs.fetch_add(1, std::memory_order_relaxed);
+        return node;
+    }
+
+    /// @brief Уменьшает счетчик ссылок и освобождает узел (и, рекурсивно, потомков), если ссылок не осталось.
+    static void release(const PRBNode* node) {
+        if (node && node->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            release(node->left);
+            release(node->right);
+            delete node;
+        }
+    }
+
+    /// @brief Создает новый узел, захватывая ссылки на потомков.
+    /// @return Узел со счетчиком ссылок 1, принадлежащий вызывающему.
+    static const PRBNode* makeNode(Color c, const PRBNode* l, const DataObject& d, const PRBNode* r) {
+        return new PRBNode(c, retain(l), d, retain(r));
+    }
+
+    /// @brief Проверяет, является ли узел красным.
+    static bool isRed(const PRBNode* node) {
+        return node && node->color == RED;
+    }
+
+    /// @brief Строит узел с балансировкой красно-красного нарушения под черным узлом.
+    /// @param c Цвет узла.
+    /// @param l Левое поддерево (заимствуется).
+    /// @param d Данные узла.
+    /// @param r Правое поддерево (заимствуется).
+    /// @return Новый узел, принадлежащий вызывающему.
+    static const PRBNode* balance(Color c, const PRBNode* l, const DataObject& d, const PRBNode* r) {
+        if (c == BLACK) {
+            if (isRed(l) && isRed(l->left)) {
+                const PRBNode* a = makeNode(BLACK, l->left->left, l->left->data, l->left->right);
+                const PRBNode* b = makeNode(BLACK, l->right, d, r);
+                const PRBNode* result = makeNode(RED, a, l->data, b);
+                release(a);
+                release(b);
+                return result;
+            }
+            if (isRed(l) && isRed(l->right)) {
+                const PRBNode* a = makeNode(BLACK, l->left, l->data, l->right->left);
+                const PRBNode* b = makeNode(BLACK, l->right->right, d, r);
+                const PRBNode* result = makeNode(RED, a, l->right->data, b);
+                release(a);
+                release(b);
+                return result;
+            }
+            if (isRed(r) && isRed(r->left)) {
+                const PRBNode* a = makeNode(BLACK, l, d, r->left->left);
+                const PRBNode* b = makeNode(BLACK, r->left->right, r->data, r->right);
+                const PRBNode* result = makeNode(RED, a, r->left->data, b);
+                release(a);
+                release(b);
+                return result;
+            }
+            if (isRed(r) && isRed(r->right)) {
+                const PRBNode* a = makeNode(BLACK, l, d, r->left);
+                const PRBNode* b = makeNode(BLACK, r->right->left, r->right->data, r->right->right);
+                const PRBNode* result = makeNode(RED, a, r->data, b);
+                release(a);
+                release(b);
+                return result;
+            }
+        }
+        return makeNode(c, l, d, r);
+    }
+
+    /// @brief Рекурсивно вставляет объект, копируя путь от узла до места вставки.
+    /// @param node Корень поддерева (заимствуется).
+    /// @param obj Объект для вставки.
+    /// @return Новый корень поддерева, принадлежащий вызывающему.
+    static const PRBNode* insertRecursive(const PRBNode* node, const DataObject& obj) {
+        if (node == nullptr) {
+            return makeNode(RED, nullptr, obj, nullptr);
+        }
+        if (obj.key < node->data.key) {
+            const PRBNode* newLeft = insertRecursive(node->left, obj);
+            const PRBNode* result = balance(node->color, newLeft, node->data, node->right);
+            release(newLeft);
+            return result;
+        }
+        const PRBNode* newRight = insertRecursive(node->right, obj);
+        const PRBNode* result = balance(node->color, node->left, node->data, newRight);
+        release(newRight);
+        return result;
+    }
+
+    /// @brief Рекурсивно ищет все объекты с заданным ключом.
+    /// @param node Текущий узел.
+    /// @param searchKey Ключ для поиска.
+    /// @param results Вектор для накопления найденных объектов.
+    static void searchRecursive(const PRBNode* node, std::string_view searchKey, std::vector<DataObject>& results) {
+        if (node == nullptr) {
+            return;
+        }
+        if (searchKey == node->data.key) {
+            searchRecursive(node->left, searchKey, results);
+            results.push_back(node->data);
+            searchRecursive(node->right, searchKey, results);
+        } else if (searchKey < node->data.key) {
+            searchRecursive(node->left, searchKey, results);
+        } else {
+            searchRecursive(node->right, searchKey, results);
+        }
+    }
+
+    /// @brief Создает версию, принимая во владение ссылку на корень.
+    explicit PersistentRedBlackTree(const PRBNode* ownedRoot) : root(ownedRoot) {}
+
+public:
+    /// @brief Конструктор пустой версии.
+    PersistentRedBlackTree() : root(nullptr) {}
+
+    /// @brief Копирование версии: O(1), узлы разделяются.
+    PersistentRedBlackTree(const PersistentRedBlackTree& other) : root(retain(other.root)) {}
+
+    PersistentRedBlackTree(PersistentRedBlackTree&& other) noexcept : root(other.root) {
+        other.root = nullptr;
+    }
+
+    PersistentRedBlackTree& operator=(PersistentRedBlackTree other) noexcept {
+        std::swap(root, other.root);
+        return *this;
+    }
+
+    /// @brief Деструктор: освобождает узлы, не используемые другими версиями.
+    ~PersistentRedBlackTree() {
+        release(root);
+    }
+
+    /// @brief Возвращает новую версию дерева с добавленным объектом; текущая версия не меняется.
+    /// @param obj Объект для вставки. Сложность O(log N) по времени и по новой памяти.
+    /// @return Новая версия дерева.
+    PersistentRedBlackTree insert(const DataObject& obj) const {
+        const PRBNode* newRoot = insertRecursive(root, obj);
+        if (newRoot->color == RED) {
+            const PRBNode* blackRoot = makeNode(BLACK, newRoot->left, newRoot->data, newRoot->right);
+            release(newRoot);
+            newRoot = blackRoot;
+        }
+        return PersistentRedBlackTree(newRoot);
+    }
+
+    /// @brief Ищет все объекты с заданным ключом в данной версии.
+    /// @param searchKey Ключ для поиска.
+    /// @return Вектор найденных объектов DataObject. Сложность O(log N + k).
+    std::vector<DataObject> search(std::string_view searchKey) const {
+        std::vector<DataObject> results;
+        searchRecursive(root, searchKey, results);
+        return results;
+    }
+
+    /// @brief Строит версию из вектора данных (промежуточные версии сразу освобождаются).
+    /// @param data Вектор объектов DataObject.
+    void build(const std::vector<DataObject>& data) {
+        PersistentRedBlackTree tree;
+        for (const auto& obj : data) {
+            tree = tree.insert(obj);
+        }
+        *this = std::move(tree);
+    }
+
+    /// @brief Возвращает число узлов всех существующих версий.
+    static size_t liveNodeCount() {
+        return PRBNode::live_nodes.load(std::memory_order_relaxed);
+    }
+};
+
+
+/// @brief Элемент цепочки хеш-таблицы: объект вместе с полным хешем его ключа.
+/// Сохраненный хеш позволяет отбросить несовпадающий элемент одним сравнением целых чисел
+/// и не пересчитывать хеш строки при перераспределении по корзинам.
+/// @tparam Value Тип записи с полем key.
+/// @tparam StoreHash Хранить ли хеш (false для целочисленных ключей, см. специализацию).
+template <typename Value, bool StoreHash = true>
+struct BasicHashEntry {
+    /// @brief Полный (не приведенный по модулю) хеш ключа obj.key.
+    size_t hash;
+    /// @brief Хранимый объект.
+    Value obj;
+
+    /// @brief Быстрая проверка перед сравнением ключей: совпадает ли сохраненный хеш.
+    bool hashMatches(size_t h) const {
+        return hash == h;
+    }
+};
+
+/// @brief Элемент цепочки без хеша: целочисленный ключ сравнивается так же дешево, как хеш,
+/// поэтому хранить хеш незачем и элемент короче на 8 байт.
+template <typename Value>
+struct BasicHashEntry<Value, false> {
+    /// @brief Хранимый объект.
+    Value obj;
+
+    bool hashMatches(size_t) const {
+        return true;
+    }
+};
+
+/// @brief Элемент цепочки хеш-таблицы со строковым ключом и объектом DataObject.
+using HashEntry = BasicHashEntry<DataObject>;
+
+
+/// @brief Класс, реализующий хеш-таблицу с методом цепочек для разрешения коллизий.
+/// @tparam Key Тип ключа (тип поля key записи).
+/// @tparam Value Тип записи с полем key.
+/// @tparam Hash Хеш ключа; должен принимать lookup_type и давать для него то же значение, что для Key.
+template <typename Key, typename Value, typename Hash = KeyHash<Key>>
+class BasicHashTable {
+    static_assert(std::is_same_v<RecordKey<Value>, Key>, "Value::key должен иметь тип Key");
+
+public:
+    /// @brief Тип элемента цепочки: для целочисленных ключей без сохраненного хеша.
+    using Entry = BasicHashEntry<Value, !std::is_integral_v<Key>>;
+    /// @brief Тип аргумента поиска (std::string_view для строк, значение для целых).
+    using lookup_type = LookupKey<Key>;
+
+private:
+    /// @brief Основное хранилище хеш-таблицы: вектор списков (цепочек).
+    std::vector<std::list<Entry>> table;
+    /// @brief Текущий размер вектора table (количество "корзин").
+    size_t table_size;
+    /// @brief Счетчик коллизий, возникших при вставке.
+    size_t collision_count;
+
+    /// @brief Переводит полный хеш ключа в индекс корзины.
+    /// @param hash Полный хеш ключа (см. hashFunction).
+    /// @return Хеш-индекс в диапазоне [0, table_size - 1].
+    size_t bucketIndex(size_t hash) const {
+        return table_size > 0 ? hash % table_size : 0;
+    }
+
+    /// @brief Проверяет, является ли число простым.
+    /// @param n Число для проверки.
+    /// @return true, если n простое, иначе false.
+    bool isPrime(size_t n) const {
+        if (n <= 1) return false;
+        if (n <= 3) return true;
+        if (n % 2 == 0 || n % 3 == 0) return false;
+        for (size_t i = 5; i * i <= n; i = i + 6) {
+            if (n % i == 0 || n % (i + 2) == 0) return false;
         }
-        table[index].push_back(obj);
+        return true;
     }
 
-    /// @brief Ищет все объекты с заданным ключом в хеш-таблице.
-    /// @param searchKey Ключ для поиска.
-    /// @return Вектор найденных объектов DataObject. Сложность в среднем O(1 + k), в худшем O(N + k), где k - число найденных.
-    std::vector<DataObject> search(const std::string& searchKey) const {
-        std::vector<DataObject> results;
-        if (table_size == 0) return results;
+    /// @brief Находит следующее простое число, не меньшее n.
+    /// Используется для выбора оптимального размера хеш-таблицы.
+    /// @param n Начальное число.
+    /// @return Ближайшее простое число >= n.
+    size_t findNextPrime(size_t n) const {
+        if (n <= 2) return 2;
+        n = static_cast<size_t>(static_cast<double>(n) * 1.5);
+        if (n % 2 == 0) n++;
+        while (!isPrime(n)) {
+            n += 2;
+        }
+        return n;
+    }
+
+
+public:
+    /// @brief Хеш-функция для ключа (см. KeyHash: для строк std::hash<std::string_view>,
+    /// для целых - мультипликативный хеш).
+    /// @param key Ключ для хеширования.
+    /// @return Полный хеш ключа; он же сохраняется в элементе цепочки.
+    static size_t hashFunction(lookup_type key) {
+        return Hash{}(key);
+    }
+
+    /// @brief Конструктор хеш-таблицы.
+    /// @param expected_elements Ожидаемое количество элементов (для выбора размера таблицы).
+    BasicHashTable(size_t expected_elements) : collision_count(0) {
+        table_size = findNextPrime(std::max(static_cast<size_t>(1), expected_elements));
+        table.resize(table_size);
+    }
+
+    /// @brief Вставляет запись в хеш-таблицу.
+    /// @param obj Объект для вставки. Сложность в среднем O(1), в худшем O(N).
+    void insert(const Value& obj) {
+        if (table_size == 0) {
+             *this = BasicHashTable(1);
+        }
+
+        size_t hash = hashFunction(obj.key);
+        size_t index = bucketIndex(hash);
+
+        if (index >= table_size) {
+            std::cerr << "Ошибка хеш-функции: Индекс " << index << " вне диапазона [0, " << table_size - 1 << "]" << std::endl;
+            return;
+        }
+
+
+        if (!table[index].empty()) {
+             bool key_already_present_in_bucket = false;
+             for(const auto& existing : table[index]) {
+                 if (existing.hashMatches(hash) && existing.obj.key == obj.key) {
+                     key_already_present_in_bucket = true;
+                     break;
+                 }
+             }
+             if (!key_already_present_in_bucket) {
+                 collision_count++;
+             }
+        }
+        if constexpr (std::is_integral_v<Key>) {
+            table[index].push_back(Entry{obj});
+        } else {
+            table[index].push_back(Entry{hash, obj});
+        }
+    }
+
+    /// @brief Ищет все объекты с заданным ключом в хеш-таблице.
+    /// @param searchKey Ключ для поиска.
+    /// @return Вектор найденных записей. Сложность в среднем O(1 + k), в худшем O(N + k), где k - число найденных.
+    /// @note Элементы цепочки с другим хешем отсекаются сравнением целых чисел, без сравнения строк.
+    std::vector<Value> search(lookup_type searchKey) const {
+        NoSearchStats stats;
+        return search(searchKey, stats);
+    }
+
+    /// @brief Ищет все объекты с заданным ключом с учетом работы поиска:
+    /// посещенные узлы - просмотренные элементы цепочки, строки сравниваются только при равных хешах.
+    /// @tparam Stats Политика учета работы.
+    /// @param searchKey Ключ для поиска.
+    /// @param stats Счетчики работы.
+    /// @return Вектор найденных записей.
+    template <typename Stats>
+    std::vector<Value> search(lookup_type searchKey, Stats& stats) const {
+        std::vector<Value> results;
+        if (table_size == 0) return results;
+
+        size_t hash = hashFunction(searchKey);
+        size_t index = bucketIndex(hash);
+        if (index >= table_size) return results;
+
+        const auto& bucket = table[index];
+        for (const auto& entry : bucket) {
+            stats.visitNode();
+            if (!entry.hashMatches(hash)) continue;
+            stats.compareKeys(searchKey, entry.obj.key);
+            if (entry.obj.key == searchKey) {
+                results.push_back(entry.obj);
+            }
+        }
+        return results;
+    }
+
+    /// @brief Удаляет все объекты с заданным ключом.
+    /// @param key Ключ удаляемых объектов.
+    /// @return Количество удаленных объектов. Сложность в среднем O(1 + k).
+    /// @note Счетчик коллизий отражает историю вставок и при удалении не уменьшается.
+    size_t erase(lookup_type key) {
+        if (table_size == 0) return 0;
+        size_t hash = hashFunction(key);
+        auto& bucket = table[bucketIndex(hash)];
+        size_t removed = 0;
+        for (auto it = bucket.begin(); it != bucket.end(); ) {
+            if (it->hashMatches(hash) && it->obj.key == key) {
+                it = bucket.erase(it);
+                ++removed;
+            } else {
+                ++it;
+            }
+        }
+        return removed;
+    }
+
+    /// @brief Удаляет первый объект с заданным ключом, удовлетворяющий предикату.
+    /// @tparam Predicate Тип предиката bool(const Value&).
+    /// @param key Ключ удаляемого объекта.
+    /// @param pred Предикат отбора среди объектов с ключом key.
+    /// @return true, если объект был найден и удален. Сложность в среднем O(1 + k).
+    template <typename Predicate>
+    bool eraseOne(lookup_type key, Predicate pred) {
+        if (table_size == 0) return false;
+        size_t hash = hashFunction(key);
+        auto& bucket = table[bucketIndex(hash)];
+        for (auto it = bucket.begin(); it != bucket.end(); ++it) {
+            if (it->hashMatches(hash) && it->obj.key == key && pred(static_cast<const Value&>(it->obj))) {
+                bucket.erase(it);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// @brief Изменяет на месте все объекты с заданным ключом.
+    /// @tparam Mutator Тип функции void(Value&).
+    /// @param key Ключ изменяемых объектов.
+    /// @param mutate Функция изменения; не должна менять ключ объекта.
+    /// @return Количество измененных объектов. Сложность в среднем O(1 + k).
+    template <typename Mutator>
+    size_t update(lookup_type key, Mutator mutate) {
+        if (table_size == 0) return 0;
+        size_t hash = hashFunction(key);
+        size_t updated = 0;
+        for (auto& entry : table[bucketIndex(hash)]) {
+            if (entry.hashMatches(hash) && entry.obj.key == key) {
+                mutate(entry.obj);
+                ++updated;
+            }
+        }
+        return updated;
+    }
+
+    /// @brief Заменяет первый объект с ключом obj.key или вставляет obj, если такого ключа нет.
+    /// @param obj Новое значение объекта.
+    /// @return true, если объект был вставлен, false - если заменен существующий.
+    bool upsert(const Value& obj) {
+        if (table_size > 0) {
+            size_t hash = hashFunction(obj.key);
+            for (auto& existing : table[bucketIndex(hash)]) {
+                if (existing.hashMatches(hash) && existing.obj.key == obj.key) {
+                    existing.obj = obj;
+                    return false;
+                }
+            }
+        }
+        insert(obj);
+        return true;
+    }
+
+    /// @brief Возвращает количество коллизий, зафиксированных при вставках.
+    /// @return Число коллизий.
+    size_t getCollisionCount() const {
+        return collision_count;
+    }
+
+    /// @brief Возвращает количество корзин таблицы.
+    size_t bucketCount() const {
+        return table_size;
+    }
+
+    /// @brief Строит хеш-таблицу из существующего вектора данных.
+    /// @param data Вектор записей.
+    void build(const std::vector<Value>& data) {
+        *this = BasicHashTable(data.size());
+
+        for(const auto& obj : data) {
+            insert(obj);
+        }
+    }
+};
+
+/// @brief Хеш-таблица со строковым ключом и объектами DataObject.
+using HashTable = BasicHashTable<std::string, DataObject>;
+
+
+/// @brief Максимальное число байт сжатого пути, хранимых непосредственно в узле ART.
+/// Более длинные префиксы проверяются оптимистично: остаток сверяется по ключу листа.
+constexpr size_t ART_MAX_PREFIX_LEN = 8;
+
+/// @brief Тип узла адаптивного префиксного дерева (ART).
+enum ARTNodeType : uint8_t { ART_NODE4, ART_NODE16, ART_NODE48, ART_NODE256, ART_LEAF };
+
+/// @brief Общий заголовок всех узлов ART.
+/// Хранит тип узла, число потомков и сжатый путь (path compression).
+struct ARTNode {
+    /// @brief Тип узла, определяет фактическую структуру за заголовком.
+    ARTNodeType type;
+    /// @brief Количество непустых потомков (до 256 включительно).
+    uint16_t numChildren;
+    /// @brief Полная длина сжатого пути, пропускаемого при спуске через узел.
+    uint32_t prefixLen;
+    /// @brief Первые байты сжатого пути (не более ART_MAX_PREFIX_LEN).
+    unsigned char prefix[ART_MAX_PREFIX_LEN];
+
+    /// @brief Конструктор заголовка узла.
+    /// @param t Тип узла.
+    explicit ARTNode(ARTNodeType t) : type(t), numChildren(0), prefixLen(0), prefix{} {}
+};
+
+/// @brief Лист ART: полный ключ и все объекты с этим ключом (дубликаты).
+struct ARTLeaf : ARTNode {
+    /// @brief Полный ключ, используется для окончательной проверки совпадения.
+    std::string key;
+    /// @brief Объекты DataObject с данным ключом в порядке вставки.
+    std::vector<DataObject> values;
+
+    /// @brief Конструктор листа.
+    /// @param obj Первый объект, сохраняемый в листе.
+    explicit ARTLeaf(const DataObject& obj) : ARTNode(ART_LEAF), key(obj.key), values{obj} {}
+};
+
+/// @brief Внутренний узел на 4 потомка: отсортированные байты и указатели.
+struct ARTNode4 : ARTNode {
+    unsigned char keys[4] = {};
+    ARTNode* children[4] = {};
+    ARTNode4() : ARTNode(ART_NODE4) {}
+};
+
+/// @brief Внутренний узел на 16 потомков: поиск байта выполняется одной SIMD-командой сравнения.
+struct ARTNode16 : ARTNode {
+    unsigned char keys[16] = {};
+    ARTNode* children[16] = {};
+    ARTNode16() : ARTNode(ART_NODE16) {}
+};
+
+/// @brief Внутренний узел на 48 потомков: индекс по байту (0 - пусто, иначе позиция + 1).
+struct ARTNode48 : ARTNode {
+    unsigned char childIndex[256] = {};
+    ARTNode* children[48] = {};
+    ARTNode48() : ARTNode(ART_NODE48) {}
+};
+
+/// @brief Внутренний узел на 256 потомков: прямая адресация по байту.
+struct ARTNode256 : ARTNode {
+    ARTNode* children[256] = {};
+    ARTNode256() : ARTNode(ART_NODE256) {}
+};
+
+/// @brief Возвращает номер младшего установленного бита.
+/// @param mask Ненулевая битовая маска.
+/// @return Индекс младшего единичного бита.
+inline unsigned countTrailingZeros(unsigned mask) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
+
+
+/// @brief Класс, реализующий адаптивное префиксное дерево (Adaptive Radix Tree).
+/// Узлы Node4/16/48/256 меняют размер по числу потомков, общие участки ключей
+/// сжимаются в префикс узла. Стоимость поиска зависит от длины ключа, а не от log N.
+/// @note Ключ дополняется неявным завершающим байтом 0, поэтому ключи не должны содержать '\0'.
+class AdaptiveRadixTree {
+private:
+    /// @brief Указатель на корневой узел дерева.
+    ARTNode* root;
+
+    /// @brief Возвращает байт ключа на заданной глубине с учетом завершающего нуля.
+    /// @param key Ключ.
+    /// @param depth Позиция байта.
+    /// @return Байт ключа или 0 за его концом.
+    static unsigned char keyByte(std::string_view key, size_t depth) {
+        return depth < key.size() ? static_cast<unsigned char>(key[depth]) : 0;
+    }
+
+    /// @brief Ищет слот потомка по очередному байту ключа.
+    /// @param node Внутренний узел.
+    /// @param byte Байт ключа.
+    /// @return Указатель на слот потомка или nullptr, если потомка нет.
+    static ARTNode** findChild(ARTNode* node, unsigned char byte) {
+        switch (node->type) {
+            case ART_NODE4: {
+                auto* n = static_cast<ARTNode4*>(node);
+                for (uint16_t i = 0; i < n->numChildren; ++i) {
+                    if (n->keys[i] == byte) return &n->children[i];
+                }
+                return nullptr;
+            }
+            case ART_NODE16: {
+                auto* n = static_cast<ARTNode16*>(node);
+#if defined(__SSE2__) || defined(_M_X64)
+                __m128i cmp = _mm_cmpeq_epi8(_mm_set1_epi8(static_cast<char>(byte)),
+                                             _mm_loadu_si128(reinterpret_cast<const __m128i*>(n->keys)));
+                unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(cmp)) & ((1u << n->numChildren) - 1);
+                return mask ? &n->children[countTrailingZeros(mask)] : nullptr;
+#else
+                for (uint16_t i = 0; i < n->numChildren; ++i) {
+                    if (n->keys[i] == byte) return &n->children[i];
+                }
+                return nullptr;
+#endif
+            }
+            case ART_NODE48: {
+                auto* n = static_cast<ARTNode48*>(node);
+                unsigned char idx = n->childIndex[byte];
+                return idx ? &n->children[idx - 1] : nullptr;
+            }
+            case ART_NODE256: {
+                auto* n = static_cast<ARTNode256*>(node);
+                return n->children[byte] ? &n->children[byte] : nullptr;
+            }
+            default:
+                return nullptr;
+        }
+    }
+
+    /// @brief Находит самый левый (минимальный) лист поддерева.
+    /// @param node Корень поддерева.
+    /// @return Минимальный лист или nullptr для пустого поддерева.
+    static const ARTLeaf* minimum(const ARTNode* node) {
+        while (node) {
+            switch (node->type) {
+                case ART_LEAF:
+                    return static_cast<const ARTLeaf*>(node);
+                case ART_NODE4:
+                    node = static_cast<const ARTNode4*>(node)->children[0];
+                    break;
+                case ART_NODE16:
+                    node = static_cast<const ARTNode16*>(node)->children[0];
+                    break;
+                case ART_NODE48: {
+                    auto* n = static_cast<const ARTNode48*>(node);
+                    size_t i = 0;
+                    while (!n->childIndex[i]) ++i;
+                    node = n->children[n->childIndex[i] - 1];
+                    break;
+                }
+                case ART_NODE256: {
+                    auto* n = static_cast<const ARTNode256*>(node);
+                    size_t i = 0;
+                    while (!n->children[i]) ++i;
+                    node = n->children[i];
+                    break;
+                }
+            }
+        }
+        return nullptr;
+    }
+
+    /// @brief Возвращает i-й байт сжатого пути узла.
+    /// Байты за пределами ART_MAX_PREFIX_LEN берутся из минимального листа поддерева.
+    /// @param node Внутренний узел.
+    /// @param depth Глубина, с которой начинается префикс узла.
+    /// @param i Позиция внутри префикса.
+    /// @return Байт префикса.
+    static unsigned char prefixByte(const ARTNode* node, size_t depth, size_t i) {
+        if (i < ART_MAX_PREFIX_LEN) return node->prefix[i];
+        return keyByte(minimum(node)->key, depth + i);
+    }
+
+    /// @brief Копирует заголовок (число потомков и сжатый путь) между узлами.
+    /// @param dst Узел-приемник.
+    /// @param src Узел-источник.
+    static void copyHeader(ARTNode* dst, const ARTNode* src) {
+        dst->numChildren = src->numChildren;
+        dst->prefixLen = src->prefixLen;
+        std::memcpy(dst->prefix, src->prefix, ART_MAX_PREFIX_LEN);
+    }
+
+    /// @brief Добавляет потомка во внутренний узел, при переполнении заменяя узел на следующий по размеру.
+    /// @param ref Ссылка на указатель на узел (может измениться при росте).
+    /// @param byte Байт ключа нового потомка.
+    /// @param child Новый потомок.
+    static void addChild(ARTNode*& ref, unsigned char byte, ARTNode* child) {
+        switch (ref->type) {
+            case ART_NODE4: {
+                auto* n = static_cast<ARTNode4*>(ref);
+                if (n->numChildren < 4) {
+                    uint16_t pos = 0;
+                    while (pos < n->numChildren && n->keys[pos] < byte) ++pos;
+                    std::memmove(n->keys + pos + 1, n->keys + pos, n->numChildren - pos);
+                    std::memmove(n->children + pos + 1, n->children + pos, (n->numChildren - pos) * sizeof(ARTNode*));
+                    n->keys[pos] = byte;
+                    n->children[pos] = child;
+                    n->numChildren++;
+                    return;
+                }
+                auto* grown = new ARTNode16();
+                copyHeader(grown, n);
+                std::memcpy(grown->keys, n->keys, 4);
+                std::memcpy(grown->children, n->children, 4 * sizeof(ARTNode*));
+                delete n;
+                ref = grown;
+                addChild(ref, byte, child);
+                return;
+            }
+            case ART_NODE16: {
+                auto* n = static_cast<ARTNode16*>(ref);
+                if (n->numChildren < 16) {
+                    uint16_t pos = 0;
+                    while (pos < n->numChildren && n->keys[pos] < byte) ++pos;
+                    std::memmove(n->keys + pos + 1, n->keys + pos, n->numChildren - pos);
+                    std::memmove(n->children + pos + 1, n->children + pos, (n->numChildren - pos) * sizeof(ARTNode*));
+                    n->keys[pos] = byte;
+                    n->children[pos] = child;
+                    n->numChildren++;
+                    return;
+                }
+                auto* grown = new ARTNode48();
+                copyHeader(grown, n);
+                for (uint16_t i = 0; i < 16; ++i) {
+                    grown->children[i] = n->children[i];
+                    grown->childIndex[n->keys[i]] = static_cast<unsigned char>(i + 1);
+                }
+                delete n;
+                ref = grown;
+                addChild(ref, byte, child);
+                return;
+            }
+            case ART_NODE48: {
+                auto* n = static_cast<ARTNode48*>(ref);
+                if (n->numChildren < 48) {
+                    size_t pos = 0;
+                    while (n->children[pos]) ++pos;
+                    n->children[pos] = child;
+                    n->childIndex[byte] = static_cast<unsigned char>(pos + 1);
+                    n->numChildren++;
+                    return;
+                }
+                auto* grown = new ARTNode256();
+                copyHeader(grown, n);
+                for (size_t b = 0; b < 256; ++b) {
+                    if (n->childIndex[b]) grown->children[b] = n->children[n->childIndex[b] - 1];
+                }
+                delete n;
+                ref = grown;
+                addChild(ref, byte, child);
+                return;
+            }
+            case ART_NODE256: {
+                auto* n = static_cast<ARTNode256*>(ref);
+                n->children[byte] = child;
+                n->numChildren++;
+                return;
+            }
+            default:
+                return;
+        }
+    }
+
+    /// @brief Рекурсивно вставляет объект в поддерево.
+    /// @param ref Ссылка на указатель на текущий узел (может измениться).
+    /// @param obj Объект для вставки.
+    /// @param depth Число уже пройденных байт ключа.
+    void insertRecursive(ARTNode*& ref, const DataObject& obj, size_t depth) {
+        const std::string& key = obj.key;
+        if (ref == nullptr) {
+            ref = new ARTLeaf(obj);
+            return;
+        }
+
+        if (ref->type == ART_LEAF) {
+            auto* leaf = static_cast<ARTLeaf*>(ref);
+            if (leaf->key == key) {
+                leaf->values.push_back(obj);
+                return;
+            }
+            // Разделяем лист: общий участок ключей уходит в префикс нового Node4.
+            size_t lcp = 0;
+            while (keyByte(leaf->key, depth + lcp) == keyByte(key, depth + lcp)) ++lcp;
+
+            auto* split = new ARTNode4();
+            split->prefixLen = static_cast<uint32_t>(lcp);
+            for (size_t i = 0; i < std::min(lcp, ART_MAX_PREFIX_LEN); ++i) {
+                split->prefix[i] = keyByte(key, depth + i);
+            }
+            ARTNode* node = split;
+            addChild(node, keyByte(leaf->key, depth + lcp), leaf);
+            addChild(node, keyByte(key, depth + lcp), new ARTLeaf(obj));
+            ref = node;
+            return;
+        }
+
+        if (ref->prefixLen > 0) {
+            size_t diff = 0;
+            while (diff < ref->prefixLen && prefixByte(ref, depth, diff) == keyByte(key, depth + diff)) ++diff;
+
+            if (diff < ref->prefixLen) {
+                // Ключ расходится со сжатым путем: вставляем Node4 над текущим узлом.
+                auto* split = new ARTNode4();
+                split->prefixLen = static_cast<uint32_t>(diff);
+                std::memcpy(split->prefix, ref->prefix, std::min(diff, ART_MAX_PREFIX_LEN));
+
+                ARTNode* node = split;
+                if (ref->prefixLen <= ART_MAX_PREFIX_LEN) {
+                    unsigned char branch = ref->prefix[diff];
+                    ref->prefixLen -= static_cast<uint32_t>(diff + 1);
+                    std::memmove(ref->prefix, ref->prefix + diff + 1, std::min<size_t>(ref->prefixLen, ART_MAX_PREFIX_LEN));
+                    addChild(node, branch, ref);
+                } else {
+                    const ARTLeaf* minLeaf = minimum(ref);
+                    unsigned char branch = keyByte(minLeaf->key, depth + diff);
+                    ref->prefixLen -= static_cast<uint32_t>(diff + 1);
+                    for (size_t i = 0; i < std::min<size_t>(ref->prefixLen, ART_MAX_PREFIX_LEN); ++i) {
+                        ref->prefix[i] = keyByte(minLeaf->key, depth + diff + 1 + i);
+                    }
+                    addChild(node, branch, ref);
+                }
+                addChild(node, keyByte(key, depth + diff), new ARTLeaf(obj));
+                ref = node;
+                return;
+            }
+            depth += ref->prefixLen;
+        }
+
+        ARTNode** child = findChild(ref, keyByte(key, depth));
+        if (child) {
+            insertRecursive(*child, obj, depth + 1);
+        } else {
+            addChild(ref, keyByte(key, depth), new ARTLeaf(obj));
+        }
+    }
+
+    /// @brief Обходит поддерево в лексикографическом порядке ключей.
+    /// @tparam Visitor Тип функции, принимающей const DataObject&.
+    /// @param node Корень поддерева.
+    /// @param visit Функция, вызываемая для каждого объекта.
+    template <typename Visitor>
+    static void visitInOrder(const ARTNode* node, Visitor& visit) {
+        if (node == nullptr) return;
+        switch (node->type) {
+            case ART_LEAF:
+                for (const auto& obj : static_cast<const ARTLeaf*>(node)->values) visit(obj);
+                return;
+            case ART_NODE4: {
+                auto* n = static_cast<const ARTNode4*>(node);
+                for (uint16_t i = 0; i < n->numChildren; ++i) visitInOrder(n->children[i], visit);
+                return;
+            }
+            case ART_NODE16: {
+                auto* n = static_cast<const ARTNode16*>(node);
+                for (uint16_t i = 0; i < n->numChildren; ++i) visitInOrder(n->children[i], visit);
+                return;
+            }
+            case ART_NODE48: {
+                auto* n = static_cast<const ARTNode48*>(node);
+                for (size_t b = 0; b < 256; ++b) {
+                    if (n->childIndex[b]) visitInOrder(n->children[n->childIndex[b] - 1], visit);
+                }
+                return;
+            }
+            case ART_NODE256: {
+                auto* n = static_cast<const ARTNode256*>(node);
+                for (size_t b = 0; b < 256; ++b) visitInOrder(n->children[b], visit);
+                return;
+            }
+        }
+    }
+
+    /// @brief Рекурсивно удаляет узлы дерева, освобождая память.
+    /// @param node Узел для удаления.
+    static void destroyRecursive(ARTNode* node) {
+        if (node == nullptr) return;
+        switch (node->type) {
+            case ART_LEAF:
+                delete static_cast<ARTLeaf*>(node);
+                return;
+            case ART_NODE4: {
+                auto* n = static_cast<ARTNode4*>(node);
+                for (uint16_t i = 0; i < n->numChildren; ++i) destroyRecursive(n->children[i]);
+                delete n;
+                return;
+            }
+            case ART_NODE16: {
+                auto* n = static_cast<ARTNode16*>(node);
+                for (uint16_t i = 0; i < n->numChildren; ++i) destroyRecursive(n->children[i]);
+                delete n;
+                return;
+            }
+            case ART_NODE48: {
+                auto* n = static_cast<ARTNode48*>(node);
+                for (size_t i = 0; i < 48; ++i) destroyRecursive(n->children[i]);
+                delete n;
+                return;
+            }
+            case ART_NODE256: {
+                auto* n = static_cast<ARTNode256*>(node);
+                for (size_t b = 0; b < 256; ++b) destroyRecursive(n->children[b]);
+                delete n;
+                return;
+            }
+        }
+    }
+
+    /// @brief Рекурсивно подсчитывает память поддерева.
+    /// @param node Корень поддерева.
+    /// @return Размер узлов, векторов листьев и строк в куче, в байтах.
+    static size_t memoryRecursive(const ARTNode* node) {
+        if (node == nullptr) return 0;
+        switch (node->type) {
+            case ART_LEAF: {
+                auto* leaf = static_cast<const ARTLeaf*>(node);
+                size_t bytes = sizeof(ARTLeaf) + stringHeapBytes(leaf->key) + leaf->values.capacity() * sizeof(DataObject);
+                for (const auto& obj : leaf->values) bytes += stringHeapBytes(obj.key);
+                return bytes;
+            }
+            case ART_NODE4: {
+                auto* n = static_cast<const ARTNode4*>(node);
+                size_t bytes = sizeof(ARTNode4);
+                for (uint16_t i = 0; i < n->numChildren; ++i) bytes += memoryRecursive(n->children[i]);
+                return bytes;
+            }
+            case ART_NODE16: {
+                auto* n = static_cast<const ARTNode16*>(node);
+                size_t bytes = sizeof(ARTNode16);
+                for (uint16_t i = 0; i < n->numChildren; ++i) bytes += memoryRecursive(n->children[i]);
+                return bytes;
+            }
+            case ART_NODE48: {
+                auto* n = static_cast<const ARTNode48*>(node);
+                size_t bytes = sizeof(ARTNode48);
+                for (size_t i = 0; i < 48; ++i) bytes += memoryRecursive(n->children[i]);
+                return bytes;
+            }
+            case ART_NODE256: {
+                auto* n = static_cast<const ARTNode256*>(node);
+                size_t bytes = sizeof(ARTNode256);
+                for (size_t b = 0; b < 256; ++b) bytes += memoryRecursive(n->children[b]);
+                return bytes;
+            }
+        }
+        return 0;
+    }
+
+public:
+    /// @brief Конструктор ART. Инициализирует дерево пустым.
+    AdaptiveRadixTree() : root(nullptr) {}
+
+    /// @brief Деструктор ART. Освобождает всю память, занятую узлами.
+    ~AdaptiveRadixTree() {
+        destroyRecursive(root);
+    }
+
+    AdaptiveRadixTree(const AdaptiveRadixTree&) = delete;
+    AdaptiveRadixTree& operator=(const AdaptiveRadixTree&) = delete;
+
+    /// @brief Вставляет новый объект DataObject в дерево.
+    /// @param obj Объект для вставки. Сложность O(L), где L - длина ключа.
+    void insert(const DataObject& obj) {
+        insertRecursive(root, obj, 0);
+    }
+
+    /// @brief Ищет все объекты с заданным ключом в ART.
+    /// @param searchKey Ключ для поиска.
+    /// @return Вектор найденных объектов DataObject. Сложность O(L + k), где k - число найденных.
+    std::vector<DataObject> search(std::string_view searchKey) const {
+        const ARTNode* node = root;
+        size_t depth = 0;
+        while (node) {
+            if (node->type == ART_LEAF) {
+                auto* leaf = static_cast<const ARTLeaf*>(node);
+                return leaf->key == searchKey ? leaf->values : std::vector<DataObject>{};
+            }
+            // Оптимистичная проверка: сравниваются только хранимые байты префикса,
+            // окончательное совпадение подтверждается сравнением ключа в листе.
+            size_t stored = std::min<size_t>(node->prefixLen, ART_MAX_PREFIX_LEN);
+            for (size_t i = 0; i < stored; ++i) {
+                if (node->prefix[i] != keyByte(searchKey, depth + i)) return {};
+            }
+            depth += node->prefixLen;
+            if (depth > searchKey.size()) return {};
+
+            ARTNode** child = findChild(const_cast<ARTNode*>(node), keyByte(searchKey, depth));
+            node = child ? *child : nullptr;
+            depth++;
+        }
+        return {};
+    }
+
+    /// @brief Обходит все объекты, ключ которых начинается с заданного префикса, в порядке возрастания ключей.
+    /// @tparam Visitor Тип функции, принимающей const DataObject&.
+    /// @param keyPrefix Искомый префикс ключа.
+    /// @param visit Функция, вызываемая для каждого найденного объекта.
+    template <typename Visitor>
+    void forEachWithPrefix(std::string_view keyPrefix, Visitor visit) const {
+        const ARTNode* node = root;
+        size_t depth = 0;
+        while (node) {
+            if (node->type == ART_LEAF) {
+                auto* leaf = static_cast<const ARTLeaf*>(node);
+                if (leaf->key.compare(0, keyPrefix.size(), keyPrefix) == 0) visitInOrder(node, visit);
+                return;
+            }
+            if (depth == keyPrefix.size()) {
+                visitInOrder(node, visit);
+                return;
+            }
+            size_t remaining = keyPrefix.size() - depth;
+            size_t toCompare = std::min<size_t>(node->prefixLen, remaining);
+            for (size_t i = 0; i < toCompare; ++i) {
+                if (prefixByte(node, depth, i) != static_cast<unsigned char>(keyPrefix[depth + i])) return;
+            }
+            if (node->prefixLen >= remaining) {
+                visitInOrder(node, visit);
+                return;
+            }
+            depth += node->prefixLen;
+
+            ARTNode** child = findChild(const_cast<ARTNode*>(node), static_cast<unsigned char>(keyPrefix[depth]));
+            node = child ? *child : nullptr;
+            depth++;
+        }
+    }
+
+    /// @brief Ищет все объекты, ключ которых начинается с заданного префикса.
+    /// @param keyPrefix Искомый префикс ключа.
+    /// @return Вектор найденных объектов в порядке возрастания ключей.
+    std::vector<DataObject> prefixSearch(std::string_view keyPrefix) const {
+        std::vector<DataObject> results;
+        forEachWithPrefix(keyPrefix, [&](const DataObject& obj) { results.push_back(obj); });
+        return results;
+    }
+
+    /// @brief Строит ART из существующего вектора данных.
+    /// @param data Вектор объектов DataObject.
+    void build(const std::vector<DataObject>& data) {
+        destroyRecursive(root);
+        root = nullptr;
+        for (const auto& obj : data) {
+            insert(obj);
+        }
+    }
+
+    /// @brief Оценивает память, занятую деревом (без служебных данных аллокатора).
+    /// @return Размер в байтах.
+    size_t memoryUsage() const {
+        return memoryRecursive(root);
+    }
+};
+
+
+/// @brief Менеджер эпох для безопасного освобождения памяти (epoch-based reclamation).
+/// Читатель объявляет текущую эпоху на время доступа к разделяемым узлам; удаленный узел
+/// освобождается только после того, как глобальная эпоха продвинется на два шага,
+/// т.е. когда ни один читатель, видевший узел, не может оставаться активным.
+class EpochManager {
+private:
+    /// @brief Значение слота, означающее, что поток не находится в критической секции.
+    static constexpr uint64_t IDLE = ~uint64_t(0);
+    /// @brief Максимальное число одновременно зарегистрированных потоков.
+    static constexpr size_t MAX_THREADS = 256;
+    /// @brief Число отложенных удалений, после которого поток пытается освободить память.
+    static constexpr size_t RECLAIM_THRESHOLD = 64;
+
+    /// @brief Отложенное удаление объекта.
+    struct Retired {
+        void* ptr;
+        void (*deleter)(void*);
+        uint64_t epoch;
+    };
+
+    /// @brief Слот потока. Выровнен по кеш-линии, чтобы объявления эпох не вызывали ложного разделения.
+    struct alignas(64) Slot {
+        /// @brief Эпоха, объявленная потоком, или IDLE.
+        std::atomic<uint64_t> epoch{IDLE};
+        /// @brief Признак того, что слот занят потоком.
+        std::atomic<bool> used{false};
+        /// @brief Глубина вложенности критических секций потока.
+        size_t depth = 0;
+        /// @brief Объекты, удаленные потоком и ожидающие освобождения.
+        std::vector<Retired> retired;
+    };
+
+    /// @brief Глобальная эпоха.
+    alignas(64) std::atomic<uint64_t> globalEpoch{0};
+    /// @brief Слоты потоков.
+    Slot slots[MAX_THREADS];
+
+    /// @brief Привязка потока к слоту; при завершении потока слот освобождается.
+    struct ThreadHandle {
+        EpochManager* manager = nullptr;
+        size_t index = 0;
+        ~ThreadHandle() {
+            if (manager) {
+                manager->slots[index].used.store(false, std::memory_order_release);
+            }
+        }
+    };
+
+    /// @brief Возвращает слот текущего потока, занимая свободный при первом обращении.
+    Slot& localSlot() {
+        thread_local ThreadHandle handle;
+        if (!handle.manager) {
+            for (size_t i = 0; ; i = (i + 1) % MAX_THREADS) {
+                bool expected = false;
+                if (!slots[i].used.load(std::memory_order_relaxed) &&
+                    slots[i].used.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                    handle.manager = this;
+                    handle.index = i;
+                    break;
+                }
+                if (i == MAX_THREADS - 1) std::this_thread::yield();
+            }
+        }
+        return slots[handle.index];
+    }
+
+    /// @brief Продвигает глобальную эпоху, если все активные потоки уже объявили текущую.
+    void tryAdvance() {
+        uint64_t current = globalEpoch.load(std::memory_order_seq_cst);
+        for (const auto& slot : slots) {
+            uint64_t e = slot.epoch.load(std::memory_order_seq_cst);
+            if (e != IDLE && e != current) return;
+        }
+        globalEpoch.compare_exchange_strong(current, current + 1, std::memory_order_seq_cst);
+    }
+
+    /// @brief Освобождает объекты слота, удаленные не менее двух эпох назад.
+    /// @param slot Слот текущего потока.
+    void reclaim(Slot& slot) {
+        uint64_t current = globalEpoch.load(std::memory_order_seq_cst);
+        auto& list = slot.retired;
+        size_t kept = 0;
+        for (size_t i = 0; i < list.size(); ++i) {
+            if (list[i].epoch + 2 <= current) {
+                list[i].deleter(list[i].ptr);
+            } else {
+                list[kept++] = list[i];
+            }
+        }
+        list.resize(kept);
+    }
+
+    EpochManager() = default;
+
+public:
+    EpochManager(const EpochManager&) = delete;
+    EpochManager& operator=(const EpochManager&) = delete;
+
+    /// @brief Деструктор: к моменту завершения программы читателей нет, освобождаем все отложенное.
+    ~EpochManager() {
+        for (auto& slot : slots) {
+            for (const auto& r : slot.retired) r.deleter(r.ptr);
+        }
+    }
+
+    /// @brief Возвращает общий для всех конкурентных структур менеджер эпох.
+    static EpochManager& instance() {
+        static EpochManager manager;
+        return manager;
+    }
+
+    /// @brief Входит в критическую секцию чтения (допускается вложенность).
+    void enter() {
+        Slot& slot = localSlot();
+        if (slot.depth++ > 0) return;
+        uint64_t e = globalEpoch.load(std::memory_order_seq_cst);
+        // Повторяем, пока объявленная эпоха не совпадет с глобальной: иначе эпоха
+        // могла продвинуться между чтением и объявлением.
+        while (true) {
+            slot.epoch.store(e, std::memory_order_seq_cst);
+            uint64_t now = globalEpoch.load(std::memory_order_seq_cst);
+            if (now == e) break;
+            e = now;
+        }
+    }
+
+    /// @brief Выходит из критической секции чтения.
+    void exit() {
+        Slot& slot = localSlot();
+        if (--slot.depth > 0) return;
+        slot.epoch.store(IDLE, std::memory_order_release);
+    }
+
+    /// @brief Откладывает удаление объекта до момента, когда его не сможет видеть ни один читатель.
+    /// @tparam T Тип объекта.
+    /// @param ptr Объект, уже исключенный из всех разделяемых структур.
+    template <typename T>
+    void retire(T* ptr) {
+        Slot& slot = localSlot();
+        slot.retired.push_back(Retired{ptr, [](void* p) { delete static_cast<T*>(p); },
+                                       globalEpoch.load(std::memory_order_seq_cst)});
+        if (slot.retired.size() >= RECLAIM_THRESHOLD) {
+            tryAdvance();
+            reclaim(slot);
+        }
+    }
+
+    /// @brief RAII-охрана критической секции.
+    class Guard {
+    public:
+        Guard() { EpochManager::instance().enter(); }
+        ~Guard() { EpochManager::instance().exit(); }
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+    };
+};
+
+
+/// @brief Конкурентная хеш-таблица с цепочками: чтение без блокировок, запись с блокировкой одной корзины.
+/// Читатели проходят цепочку по атомарным указателям внутри EpochManager::Guard и никогда не ждут
+/// писателей. Писатели сериализуются только внутри своей корзины; узлы не изменяются на месте,
+/// а заменяются копией, старые узлы освобождаются через EpochManager.
+/// @note Число корзин фиксируется при построении (степень двойки по ожидаемому числу элементов).
+class ConcurrentHashTable {
+private:
+    /// @brief Узел цепочки. После публикации неизменяем, кроме ссылки next.
+    struct Node {
+        size_t hash;
+        DataObject obj;
+        std::atomic<Node*> next;
+
+        Node(size_t h, const DataObject& o, Node* n) : hash(h), obj(o), next(n) {}
+    };
+
+    /// @brief Корзина: голова цепочки и спин-блокировка писателей.
+    struct Bucket {
+        std::atomic<Node*> head{nullptr};
+        std::atomic<bool> locked{false};
+
+        void lock() {
+            while (true) {
+                if (!locked.exchange(true, std::memory_order_acquire)) return;
+                while (locked.load(std::memory_order_relaxed)) std::this_thread::yield();
+            }
+        }
+
+        void unlock() {
+            locked.store(false, std::memory_order_release);
+        }
+    };
+
+    /// @brief Массив корзин.
+    std::unique_ptr<Bucket[]> buckets;
+    /// @brief Маска индекса корзины (число корзин - 1).
+    size_t mask;
+
+    /// @brief Возвращает корзину для полного хеша ключа.
+    Bucket& bucketFor(size_t hash) const {
+        return buckets[hash & mask];
+    }
+
+    /// @brief Освобождает все узлы (вызывается без конкурентного доступа).
+    void clear() {
+        if (!buckets) return;
+        for (size_t i = 0; i <= mask; ++i) {
+            Node* node = buckets[i].head.load(std::memory_order_relaxed);
+            while (node) {
+                Node* next = node->next.load(std::memory_order_relaxed);
+                delete node;
+                node = next;
+            }
+            buckets[i].head.store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+public:
+    /// @brief Конструктор конкурентной хеш-таблицы.
+    /// @param expected_elements Ожидаемое количество элементов (для выбора числа корзин).
+    explicit ConcurrentHashTable(size_t expected_elements) {
+        size_t count = 1;
+        while (count < expected_elements) count <<= 1;
+        buckets.reset(new Bucket[count]);
+        mask = count - 1;
+    }
+
+    /// @brief Деструктор. Должен вызываться, когда к таблице больше нет обращений.
+    ~ConcurrentHashTable() {
+        clear();
+    }
+
+    ConcurrentHashTable(const ConcurrentHashTable&) = delete;
+    ConcurrentHashTable& operator=(const ConcurrentHashTable&) = delete;
+
+    /// @brief Вставляет объект. Безопасно вызывать из нескольких потоков.
+    /// @param obj Объект для вставки. Сложность O(1).
+    void insert(const DataObject& obj) {
+        size_t hash = HashTable::hashFunction(obj.key);
+        Bucket& bucket = bucketFor(hash);
+        bucket.lock();
+        Node* node = new Node(hash, obj, bucket.head.load(std::memory_order_relaxed));
+        bucket.head.store(node, std::memory_order_release);
+        bucket.unlock();
+    }
+
+    /// @brief Ищет все объекты с заданным ключом без блокировок.
+    /// @param searchKey Ключ для поиска.
+    /// @return Вектор найденных объектов DataObject. Сложность в среднем O(1 + k).
+    std::vector<DataObject> search(std::string_view searchKey) const {
+        std::vector<DataObject> results;
+        size_t hash = HashTable::hashFunction(searchKey);
+        EpochManager::Guard guard;
+        for (Node* node = bucketFor(hash).head.load(std::memory_order_acquire); node;
+             node = node->next.load(std::memory_order_acquire)) {
+            if (node->hash == hash && node->obj.key == searchKey) {
+                results.push_back(node->obj);
+            }
+        }
+        return results;
+    }
+
+    /// @brief Удаляет первый объект с заданным ключом, удовлетворяющий предикату.
+    /// @tparam Predicate Тип предиката bool(const DataObject&).
+    /// @param key Ключ удаляемого объекта.
+    /// @param pred Предикат отбора.
+    /// @return true, если объект был удален.
+    template <typename Predicate>
+    bool eraseOne(std::string_view key, Predicate pred) {
+        size_t hash = HashTable::hashFunction(key);
+        Bucket& bucket = bucketFor(hash);
+        Node* removed = nullptr;
+        bucket.lock();
+        std::atomic<Node*>* link = &bucket.head;
+        for (Node* node = link->load(std::memory_order_relaxed); node;
+             link = &node->next, node = link->load(std::memory_order_relaxed)) {
+            if (node->hash == hash && node->obj.key == key && pred(static_cast<const DataObject&>(node->obj))) {
+                // Читатели, стоящие на удаленном узле, продолжат обход по его неизменной ссылке next.
+                link->store(node->next.load(std::memory_order_relaxed), std::memory_order_release);
+                removed = node;
+                break;
+            }
+        }
+        bucket.unlock();
+        if (removed) {
+            EpochManager::instance().retire(removed);
+        }
+        return removed != nullptr;
+    }
+
+    /// @brief Удаляет все объекты с заданным ключом.
+    /// @param key Ключ удаляемых объектов.
+    /// @return Количество удаленных объектов.
+    size_t erase(std::string_view key) {
+        size_t removed = 0;
+        while (eraseOne(key, [](const DataObject&) { return true; })) {
+            ++removed;
+        }
+        return removed;
+    }
+
+    /// @brief Заменяет первый объект с ключом obj.key копией obj или вставляет obj, если ключа нет.
+    /// @param obj Новое значение объекта.
+    /// @return true, если объект был вставлен, false - если заменен существующий.
+    bool upsert(const DataObject& obj) {
+        size_t hash = HashTable::hashFunction(obj.key);
+        Bucket& bucket = bucketFor(hash);
+        Node* replaced = nullptr;
+        bucket.lock();
+        std::atomic<Node*>* link = &bucket.head;
+        for (Node* node = link->load(std::memory_order_relaxed); node;
+             link = &node->next, node = link->load(std::memory_order_relaxed)) {
+            if (node->hash == hash && node->obj.key == obj.key) {
+                Node* copy = new Node(hash, obj, node->next.load(std::memory_order_relaxed));
+                link->store(copy, std::memory_order_release);
+                replaced = node;
+                break;
+            }
+        }
+        if (!replaced) {
+            Node* node = new Node(hash, obj, bucket.head.load(std::memory_order_relaxed));
+            bucket.head.store(node, std::memory_order_release);
+        }
+        bucket.unlock();
+        if (replaced) {
+            EpochManager::instance().retire(replaced);
+        }
+        return replaced == nullptr;
+    }
+
+    /// @brief Строит таблицу из вектора данных. Не потокобезопасно относительно других операций.
+    /// @param data Вектор объектов DataObject.
+    void build(const std::vector<DataObject>& data) {
+        clear();
+        size_t count = 1;
+        while (count < data.size()) count <<= 1;
+        buckets.reset(new Bucket[count]);
+        mask = count - 1;
+        for (const auto& obj : data) {
+            insert(obj);
+        }
+    }
+};
+
+
+/// @brief Хеш-таблица под одной глобальной блокировкой читателей-писателей.
+/// Используется как базовый вариант для сравнения с ShardedHashTable.
+class GlobalLockHashTable {
+private:
+    /// @brief Блокировка, защищающая всю таблицу.
+    mutable std::shared_mutex lock;
+    /// @brief Защищаемая таблица.
+    HashTable table;
+
+public:
+    /// @brief Конструктор.
+    /// @param expected_elements Ожидаемое количество элементов.
+    explicit GlobalLockHashTable(size_t expected_elements) : table(expected_elements) {}
+
+    /// @brief Вставляет объект под эксклюзивной блокировкой.
+    /// @param obj Объект для вставки.
+    void insert(const DataObject& obj) {
+        std::unique_lock<std::shared_mutex> guard(lock);
+        table.insert(obj);
+    }
+
+    /// @brief Ищет объекты под разделяемой блокировкой.
+    /// @param searchKey Ключ для поиска.
+    /// @return Вектор найденных объектов DataObject.
+    std::vector<DataObject> search(std::string_view searchKey) const {
+        std::shared_lock<std::shared_mutex> guard(lock);
+        return table.search(searchKey);
+    }
+
+    /// @brief Удаляет первый объект с ключом, удовлетворяющий предикату.
+    /// @tparam Predicate Тип предиката bool(const DataObject&).
+    /// @param key Ключ удаляемого объекта.
+    /// @param pred Предикат отбора.
+    /// @return true, если объект был удален.
+    template <typename Predicate>
+    bool eraseOne(std::string_view key, Predicate pred) {
+        std::unique_lock<std::shared_mutex> guard(lock);
+        return table.eraseOne(key, pred);
+    }
+
+    /// @brief Строит таблицу из вектора данных.
+    /// @param data Вектор объектов DataObject.
+    void build(const std::vector<DataObject>& data) {
+        std::unique_lock<std::shared_mutex> guard(lock);
+        table.build(data);
+    }
+};
+
+
+/// @brief Хеш-таблица, разбитая на независимые сегменты (шарды) со своими блокировками.
+/// Сегмент выбирается по старшим битам полного хеша ключа, корзина внутри сегмента -
+/// по остатку от деления, поэтому оба выбора используют разные биты хеша.
+class ShardedHashTable {
+private:
+    /// @brief Сегмент: блокировка читателей-писателей и собственная HashTable.
+    /// Выравнивание по кеш-линии исключает ложное разделение блокировок соседних сегментов.
+    struct alignas(64) Shard {
+        mutable std::shared_mutex lock;
+        HashTable table;
+
+        Shard() : table(1) {}
+    };
+
+    /// @brief Массив сегментов.
+    std::unique_ptr<Shard[]> shards;
+    /// @brief Число сегментов (степень двойки).
+    size_t shard_count;
+    /// @brief Сдвиг, оставляющий от хеша номер сегмента.
+    unsigned shard_shift;
+
+    /// @brief Возвращает сегмент для ключа.
+    /// @param key Ключ.
+    Shard& shardFor(std::string_view key) const {
+        size_t hash = HashTable::hashFunction(key);
+        return shards[shard_count > 1 ? hash >> shard_shift : 0];
+    }
+
+public:
+    /// @brief Конструктор.
+    /// @param expected_elements Ожидаемое количество элементов во всей таблице.
+    /// @param shards_hint Желаемое число сегментов (округляется вверх до степени двойки).
+    explicit ShardedHashTable(size_t expected_elements, size_t shards_hint = 64) : shard_count(1), shard_shift(0) {
+        unsigned bits = 0;
+        while (shard_count < shards_hint) {
+            shard_count <<= 1;
+            ++bits;
+        }
+        shard_shift = static_cast<unsigned>(sizeof(size_t) * 8) - bits;
+        shards.reset(new Shard[shard_count]);
+        for (size_t i = 0; i < shard_count; ++i) {
+            shards[i].table = HashTable(expected_elements / shard_count + 1);
+        }
+    }
+
+    /// @brief Вставляет объект, блокируя только его сегмент.
+    /// @param obj Объект для вставки.
+    void insert(const DataObject& obj) {
+        Shard& shard = shardFor(obj.key);
+        std::unique_lock<std::shared_mutex> guard(shard.lock);
+        shard.table.insert(obj);
+    }
+
+    /// @brief Ищет объекты под разделяемой блокировкой сегмента.
+    /// @param searchKey Ключ для поиска.
+    /// @return Вектор найденных объектов DataObject.
+    std::vector<DataObject> search(std::string_view searchKey) const {
+        Shard& shard = shardFor(searchKey);
+        std::shared_lock<std::shared_mutex> guard(shard.lock);
+        return shard.table.search(searchKey);
+    }
+
+    /// @brief Удаляет первый объект с ключом, удовлетворяющий предикату.
+    /// @tparam Predicate Тип предиката bool(const DataObject&).
+    /// @param key Ключ удаляемого объекта.
+    /// @param pred Предикат отбора.
+    /// @return true, если объект был удален.
+    template <typename Predicate>
+    bool eraseOne(std::string_view key, Predicate pred) {
+        Shard& shard = shardFor(key);
+        std::unique_lock<std::shared_mutex> guard(shard.lock);
+        return shard.table.eraseOne(key, pred);
+    }
+
+    /// @brief Заменяет первый объект с ключом obj.key или вставляет obj.
+    /// @param obj Новое значение объекта.
+    /// @return true, если объект был вставлен.
+    bool upsert(const DataObject& obj) {
+        Shard& shard = shardFor(obj.key);
+        std::unique_lock<std::shared_mutex> guard(shard.lock);
+        return shard.table.upsert(obj);
+    }
+
+    /// @brief Возвращает число сегментов.
+    size_t shardCount() const {
+        return shard_count;
+    }
+
+    /// @brief Строит таблицу из вектора данных.
+    /// @param data Вектор объектов DataObject.
+    void build(const std::vector<DataObject>& data) {
+        for (size_t i = 0; i < shard_count; ++i) {
+            std::unique_lock<std::shared_mutex> guard(shards[i].lock);
+            shards[i].table = HashTable(data.size() / shard_count + 1);
+        }
+        for (const auto& obj : data) {
+            insert(obj);
+        }
+    }
+};
+
+
+/// @brief Версионированный дескриптор индекса: чтение без простоя во время перестройки.
+/// Читатели получают снимок текущей версии (std::shared_ptr) и работают с ним, не блокируя
+/// писателя. Новая версия строится из новых данных в фоновом потоке и публикуется атомарной
+/// заменой указателя; старая версия удаляется в потоке перестройки, когда ее освободят все читатели.
+/// @tparam Index Тип индекса с методом search (RedBlackTree, HashTable и т.п.).
+template <typename Index>
+class VersionedIndex {
+public:
+    /// @brief Функция построения новой версии индекса из вектора данных.
+    using Builder = std::function<std::shared_ptr<Index>(const std::vector<DataObject>&)>;
+
+private:
+    /// @brief Текущая версия. Читается и заменяется только через std::atomic_load/std::atomic_exchange.
+    std::shared_ptr<const Index> current;
+    /// @brief Функция построения версии.
+    Builder builder;
+    /// @brief Номер опубликованной версии.
+    std::atomic<uint64_t> version_number{0};
+    /// @brief Фоновый поток перестройки.
+    std::thread rebuild_thread;
+    /// @brief Сериализует перестройки между собой.
+    std::mutex rebuild_mutex;
+
+    /// @brief Публикует новую версию и дожидается освобождения предыдущей читателями.
+    /// @param next Новая версия.
+    void publish(std::shared_ptr<const Index> next) {
+        std::shared_ptr<const Index> previous = std::atomic_exchange(&current, std::move(next));
+        version_number.fetch_add(1, std::memory_order_release);
+        // Новые читатели уже видят новую версию; ждем, пока старые снимки будут отпущены,
+        // чтобы деструктор старой версии не выполнялся в потоке читателя.
+        while (previous.use_count() > 1) {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+        previous.reset();
+    }
+
+public:
+    /// @brief Конструктор: строит первую версию синхронно.
+    /// @param build Функция построения версии.
+    /// @param initial Исходные данные.
+    VersionedIndex(Builder build, const std::vector<DataObject>& initial) : builder(std::move(build)) {
+        current = builder(initial);
+    }
+
+    /// @brief Деструктор: дожидается завершения фоновой перестройки.
+    ~VersionedIndex() {
+        waitForRebuild();
+    }
+
+    VersionedIndex(const VersionedIndex&) = delete;
+    VersionedIndex& operator=(const VersionedIndex&) = delete;
+
+    /// @brief Возвращает снимок текущей версии. Снимок остается действительным, пока он удерживается.
+    std::shared_ptr<const Index> acquire() const {
+        return std::atomic_load(&current);
+    }
+
+    /// @brief Ищет объекты в текущей версии индекса.
+    /// @param searchKey Ключ для поиска.
+    /// @return Вектор найденных объектов DataObject.
+    std::vector<DataObject> search(std::string_view searchKey) const {
+        return acquire()->search(searchKey);
+    }
+
+    /// @brief Возвращает номер опубликованной версии (0 - исходная).
+    uint64_t version() const {
+        return version_number.load(std::memory_order_acquire);
+    }
+
+    /// @brief Синхронно строит новую версию из данных и публикует ее.
+    /// @param data Новые данные.
+    void rebuild(const std::vector<DataObject>& data) {
+        std::lock_guard<std::mutex> guard(rebuild_mutex);
+        publish(builder(data));
+    }
+
+    /// @brief Запускает перестройку в фоновом потоке и сразу возвращает управление.
+    /// @param data Новые данные (передаются во владение фоновому потоку).
+    void rebuildAsync(std::vector<DataObject> data) {
+        waitForRebuild();
+        rebuild_thread = std::thread([this, owned = std::move(data)]() {
+            rebuild(owned);
+        });
+    }
+
+    /// @brief Дожидается завершения фоновой перестройки, если она запущена.
+    void waitForRebuild() {
+        if (rebuild_thread.joinable()) {
+            rebuild_thread.join();
+        }
+    }
+};
+
+
+/// @brief Отображение файла в память только для чтения (mmap / MapViewOfFile).
+/// Данные доступны по указателю без копирования; страницы подгружаются ОС по обращению.
+class MappedFile {
+private:
+    /// @brief Начало отображения.
+    const unsigned char* ptr = nullptr;
+    /// @brief Размер файла в байтах.
+    size_t length = 0;
+#ifdef _WIN32
+    HANDLE file_handle = INVALID_HANDLE_VALUE;
+    HANDLE mapping_handle = nullptr;
+#endif
+
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /// @brief Деструктор: снимает отображение.
+    ~MappedFile() {
+        close();
+    }
+
+    /// @brief Отображает файл в память.
+    /// @param path Путь к файлу.
+    /// @return true при успехе.
+    bool open(const std::string& path) {
+        close();
+#ifdef _WIN32
+        file_handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                  OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file_handle == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file_handle, &fileSize) || fileSize.QuadPart == 0) {
+            close();
+            return false;
+        }
+        mapping_handle = CreateFileMappingA(file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping_handle) {
+            close();
+            return false;
+        }
+        ptr = static_cast<const unsigned char*>(MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0));
+        length = static_cast<size_t>(fileSize.QuadPart);
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) {
+            ::close(fd);
+            return false;
+        }
+        void* mapped = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (mapped == MAP_FAILED) return false;
+        ptr = static_cast<const unsigned char*>(mapped);
+        length = static_cast<size_t>(st.st_size);
+#endif
+        if (!ptr) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    /// @brief Снимает отображение, если оно было создано.
+    void close() {
+#ifdef _WIN32
+        if (ptr) UnmapViewOfFile(ptr);
+        if (mapping_handle) CloseHandle(mapping_handle);
+        if (file_handle != INVALID_HANDLE_VALUE) CloseHandle(file_handle);
+        mapping_handle = nullptr;
+        file_handle = INVALID_HANDLE_VALUE;
+#else
+        if (ptr) munmap(const_cast<unsigned char*>(ptr), length);
+#endif
+        ptr = nullptr;
+        length = 0;
+    }
+
+    /// @brief Указатель на начало отображенных данных.
+    const unsigned char* data() const { return ptr; }
+    /// @brief Размер отображенных данных в байтах.
+    size_t size() const { return length; }
+};
+
+
+/// @brief Хеш FNV-1a (64 бита). Не зависит от платформы и реализации стандартной библиотеки,
+/// поэтому пригоден для данных, сохраняемых на диск (контрольные суммы, хеши ключей в снимках).
+/// @param bytes Данные.
+/// @param size Размер данных в байтах.
+/// @param seed Начальное значение (для продолжения вычисления по частям).
+/// @return 64-битный хеш.
+inline uint64_t fnv1a64(const void* bytes, size_t size, uint64_t seed = 1469598103934665603ULL) {
+    const unsigned char* p = static_cast<const unsigned char*>(bytes);
+    uint64_t hash = seed;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= p[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/// @brief Тип индекса, сохраненного в снимке.
+enum SnapshotKind : uint32_t { SNAPSHOT_HASH = 1, SNAPSHOT_SORTED = 2, SNAPSHOT_TREE = 3 };
+
+/// @brief Заголовок бинарного снимка индекса. Все смещения отсчитываются от начала файла,
+/// поэтому файл можно отобразить по любому адресу и использовать без разбора и без указателей.
+struct SnapshotHeader {
+    /// @brief Сигнатура формата "LAB2IDX".
+    char magic[8];
+    /// @brief Версия формата (SNAPSHOT_FORMAT_VERSION).
+    uint32_t version;
+    /// @brief Тип индекса (SnapshotKind).
+    uint32_t kind;
+    /// @brief Число записей.
+    uint64_t count;
+    /// @brief Хеш-индекс: число корзин (степень двойки); дерево: индекс корня или UINT64_MAX.
+    uint64_t param;
+    /// @brief Смещение массива SnapshotEntry.
+    uint64_t entries_offset;
+    /// @brief Смещение вспомогательного массива: границы корзин или потомки узлов дерева.
+    uint64_t aux_offset;
+    /// @brief Смещение пула строк ключей.
+    uint64_t strings_offset;
+    /// @brief Размер пула строк в байтах.
+    uint64_t strings_size;
+    /// @brief Полный размер файла.
+    uint64_t file_size;
+    /// @brief Контрольная сумма FNV-1a всего файла, включая заголовок с обнуленным полем checksum.
+    uint64_t checksum;
+};
+
+/// @brief Запись снимка: ссылка на ключ в пуле строк и значения объекта.
+struct SnapshotEntry {
+    /// @brief FNV-1a хеш ключа.
+    uint64_t hash;
+    /// @brief Смещение ключа относительно начала пула строк.
+    uint64_t key_offset;
+    /// @brief Длина ключа в байтах.
+    uint32_t key_length;
+    /// @brief Поле value1 объекта.
+    int32_t value1;
+    /// @brief Поле value2 объекта.
+    double value2;
+};
+
+/// @brief Узел дерева в снимке: индексы потомков в массиве записей (UINT32_MAX - нет потомка).
+struct SnapshotTreeLinks {
+    uint32_t left;
+    uint32_t right;
+};
+
+/// @brief Текущая версия формата снимков (2: контрольная сумма покрывает и заголовок).
+constexpr uint32_t SNAPSHOT_FORMAT_VERSION = 2;
+/// @brief Отсутствующий потомок в SnapshotTreeLinks.
+constexpr uint32_t SNAPSHOT_NO_CHILD = ~uint32_t(0);
+
+/// @brief Выравнивает смещение вверх до кратного 8.
+inline uint64_t alignSnapshotOffset(uint64_t offset) {
+    return (offset + 7) & ~uint64_t(7);
+}
+
+/// @brief Записывает снимок: заголовок, записи, вспомогательный массив и пул строк.
+/// @param path Путь к файлу снимка.
+/// @param kind Тип индекса.
+/// @param param Параметр заголовка (см. SnapshotHeader::param).
+/// @param order Объекты в порядке записи в файл.
+/// @param aux Байты вспомогательного массива.
+/// @return true при успехе.
+bool writeSnapshotFile(const std::string& path, SnapshotKind kind, uint64_t param,
+                       const std::vector<const DataObject*>& order, const std::vector<unsigned char>& aux) {
+    std::vector<SnapshotEntry> entries;
+    entries.reserve(order.size());
+    std::string strings;
+    for (const DataObject* obj : order) {
+        entries.push_back(SnapshotEntry{fnv1a64(obj->key.data(), obj->key.size()), strings.size(),
+                                        static_cast<uint32_t>(obj->key.size()), obj->value1, obj->value2});
+        strings += obj->key;
+    }
+
+    SnapshotHeader header{};
+    std::memcpy(header.magic, "LAB2IDX", 8);
+    header.version = SNAPSHOT_FORMAT_VERSION;
+    header.kind = kind;
+    header.count = entries.size();
+    header.param = param;
+    header.entries_offset = alignSnapshotOffset(sizeof(SnapshotHeader));
+    header.aux_offset = alignSnapshotOffset(header.entries_offset + entries.size() * sizeof(SnapshotEntry));
+    header.strings_offset = alignSnapshotOffset(header.aux_offset + aux.size());
+    header.strings_size = strings.size();
+    header.file_size = header.strings_offset + strings.size();
+
+    // Заголовок и тело собираются в одном буфере; сумма считается по нему с нулевым полем checksum.
+    std::vector<unsigned char> file(header.file_size, 0);
+    if (!entries.empty()) std::memcpy(file.data() + header.entries_offset, entries.data(), entries.size() * sizeof(SnapshotEntry));
+    if (!aux.empty()) std::memcpy(file.data() + header.aux_offset, aux.data(), aux.size());
+    if (!strings.empty()) std::memcpy(file.data() + header.strings_offset, strings.data(), strings.size());
+    header.checksum = 0;
+    std::memcpy(file.data(), &header, sizeof(header));
+    header.checksum = fnv1a64(file.data(), file.size());
+    std::memcpy(file.data(), &header, sizeof(header));
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(file.data()), static_cast<std::streamsize>(file.size()));
+    return static_cast<bool>(out);
+}
+
+/// @brief Сохраняет хеш-индекс: записи сгруппированы по корзинам, aux - границы корзин (CSR, uint64).
+/// @param path Путь к файлу снимка.
+/// @param data Вектор объектов DataObject.
+/// @return true при успехе.
+bool writeHashSnapshot(const std::string& path, const std::vector<DataObject>& data) {
+    uint64_t bucketCount = 1;
+    while (bucketCount < data.size()) bucketCount <<= 1;
+
+    std::vector<uint64_t> bounds(bucketCount + 1, 0);
+    std::vector<uint64_t> bucketOf(data.size());
+    for (size_t i = 0; i < data.size(); ++i) {
+        bucketOf[i] = fnv1a64(data[i].key.data(), data[i].key.size()) & (bucketCount - 1);
+        bounds[bucketOf[i] + 1]++;
+    }
+    for (uint64_t b = 0; b < bucketCount; ++b) bounds[b + 1] += bounds[b];
+
+    std::vector<const DataObject*> order(data.size());
+    std::vector<uint64_t> fill(bounds.begin(), bounds.end() - 1);
+    for (size_t i = 0; i < data.size(); ++i) {
+        order[fill[bucketOf[i]]++] = &data[i];
+    }
+
+    std::vector<unsigned char> aux(bounds.size() * sizeof(uint64_t));
+    std::memcpy(aux.data(), bounds.data(), aux.size());
+    return writeSnapshotFile(path, SNAPSHOT_HASH, bucketCount, order, aux);
+}
+
+/// @brief Сохраняет отсортированный индекс: записи упорядочены по ключу, aux пуст.
+/// @param path Путь к файлу снимка.
+/// @param data Вектор объектов DataObject.
+/// @return true при успехе.
+bool writeSortedSnapshot(const std::string& path, const std::vector<DataObject>& data) {
+    std::vector<const DataObject*> order;
+    order.reserve(data.size());
+    for (const auto& obj : data) order.push_back(&obj);
+    std::stable_sort(order.begin(), order.end(),
+                     [](const DataObject* a, const DataObject* b) { return a->key < b->key; });
+    return writeSnapshotFile(path, SNAPSHOT_SORTED, 0, order, {});
+}
+
+/// @brief Сохраняет Красно-Черное дерево в развернутом виде: узлы в прямом порядке обхода,
+/// aux - индексы левого и правого потомков (SnapshotTreeLinks) вместо указателей.
+/// @param path Путь к файлу снимка.
+/// @param tree Дерево для сохранения.
+/// @return true при успехе.
+bool writeTreeSnapshot(const std::string& path, const RedBlackTree& tree) {
+    std::vector<const DataObject*> order;
+    std::vector<SnapshotTreeLinks> links;
+    // Стек пар (узел, ссылка на поле потомка у родителя, которое нужно заполнить).
+    std::vector<std::pair<const RBTNode*, std::pair<size_t, bool>>> stack;
+    const size_t NO_PARENT = ~size_t(0);
+    if (tree.rootNode()) stack.push_back({tree.rootNode(), {NO_PARENT, false}});
+    while (!stack.empty()) {
+        auto [node, parentLink] = stack.back();
+        stack.pop_back();
+        uint32_t index = static_cast<uint32_t>(order.size());
+        order.push_back(&node->data);
+        links.push_back(SnapshotTreeLinks{SNAPSHOT_NO_CHILD, SNAPSHOT_NO_CHILD});
+        if (parentLink.first != NO_PARENT) {
+            if (parentLink.second) links[parentLink.first].right = index;
+            else links[parentLink.first].left = index;
+        }
+        if (node->right) stack.push_back({node->right, {index, true}});
+        if (node->left) stack.push_back({node->left, {index, false}});
+    }
+
+    std::vector<unsigned char> aux(links.size() * sizeof(SnapshotTreeLinks));
+    if (!links.empty()) std::memcpy(aux.data(), links.data(), aux.size());
+    return writeSnapshotFile(path, SNAPSHOT_TREE, order.empty() ? ~uint64_t(0) : 0, order, aux);
+}
+
+
+/// @brief Индекс, загруженный из снимка и используемый на месте в отображенной памяти.
+/// Загрузка не строит структуру: проверяются заголовок и контрольная сумма, после чего
+/// поиск работает прямо по записям файла.
+class IndexSnapshot {
+private:
+    /// @brief Отображенный файл.
+    MappedFile file;
+    /// @brief Заголовок снимка.
+    const SnapshotHeader* header = nullptr;
+    /// @brief Массив записей.
+    const SnapshotEntry* entries = nullptr;
+    /// @brief Вспомогательный массив (его тип зависит от вида индекса).
+    const unsigned char* aux = nullptr;
+    /// @brief Пул строк ключей.
+    const char* strings = nullptr;
+
+    /// @brief Возвращает ключ записи как срез пула строк.
+    std::string_view keyOf(const SnapshotEntry& entry) const {
+        return std::string_view(strings + entry.key_offset, entry.key_length);
+    }
+
+    /// @brief Материализует запись в DataObject.
+    DataObject toObject(const SnapshotEntry& entry) const {
+        return DataObject(std::string(keyOf(entry)), entry.value1, entry.value2);
+    }
+
+    /// @brief Сообщает об ошибке загрузки и закрывает файл.
+    bool fail(const std::string& path, const char* reason) {
+        std::cerr << "Ошибка загрузки снимка " << path << ": " << reason << std::endl;
+        file.close();
+        header = nullptr;
+        return false;
+    }
+
+    /// @brief Итеративный поиск по развернутому дереву в порядке обхода in-order. Глубина файла
+    /// проверяется в open только косвенно (потомок дальше родителя), поэтому рекурсия недопустима:
+    /// цепочка из count узлов переполнила бы стек. Явный стек хранит лишь узлы с искомым ключом,
+    /// ждущие обхода правого поддерева.
+    void searchTree(uint32_t index, std::string_view searchKey, std::vector<DataObject>& results) const {
+        const SnapshotTreeLinks* links = reinterpret_cast<const SnapshotTreeLinks*>(aux);
+        std::vector<uint32_t> pending;
+        while (index != SNAPSHOT_NO_CHILD || !pending.empty()) {
+            if (index == SNAPSHOT_NO_CHILD) {
+                uint32_t match = pending.back();
+                pending.pop_back();
+                results.push_back(toObject(entries[match]));
+                index = links[match].right;
+                continue;
+            }
+            std::string_view key = keyOf(entries[index]);
+            if (searchKey < key) {
+                index = links[index].left;
+            } else if (key < searchKey) {
+                index = links[index].right;
+            } else {
+                pending.push_back(index);
+                index = links[index].left;
+            }
+        }
+    }
+
+public:
+    /// @brief Открывает снимок и проверяет его целостность.
+    /// @param path Путь к файлу снимка.
+    /// @param kind Ожидаемый тип индекса.
+    /// @return true, если снимок корректен и готов к поиску.
+    bool open(const std::string& path, SnapshotKind kind) {
+        if (!file.open(path)) return fail(path, "не удалось отобразить файл");
+        if (file.size() < sizeof(SnapshotHeader)) return fail(path, "файл меньше заголовка");
+
+        header = reinterpret_cast<const SnapshotHeader*>(file.data());
+        if (std::memcmp(header->magic, "LAB2IDX", 8) != 0) return fail(path, "неверная сигнатура");
+        if (header->version != SNAPSHOT_FORMAT_VERSION) return fail(path, "неподдерживаемая версия формата");
+        if (header->kind != kind) return fail(path, "неверный тип индекса");
+        SnapshotHeader unsummed = *header;
+        unsummed.checksum = 0;
+        uint64_t checksum = fnv1a64(&unsummed, sizeof(unsummed));
+        checksum = fnv1a64(file.data() + sizeof(SnapshotHeader), file.size() - sizeof(SnapshotHeader), checksum);
+        if (checksum != header->checksum) return fail(path, "неверная контрольная сумма");
+
+        // Сумма защищает от случайной порчи, но не от подобранного файла, поэтому все смещения
+        // и индексы, по которым потом читается отображение, проверяются явно (без переполнений).
+        const uint64_t size = file.size();
+        if (header->file_size != size ||
+            header->entries_offset < sizeof(SnapshotHeader) || header->entries_offset % 8 != 0 ||
+            header->aux_offset % 8 != 0 || header->strings_offset % 8 != 0 ||
+            header->entries_offset > header->aux_offset || header->aux_offset > header->strings_offset ||
+            header->strings_offset > size || header->strings_size > size - header->strings_offset ||
+            header->count > (header->aux_offset - header->entries_offset) / sizeof(SnapshotEntry)) {
+            return fail(path, "некорректные смещения");
+        }
+        const uint64_t auxSize = header->strings_offset - header->aux_offset;
+
+        entries = reinterpret_cast<const SnapshotEntry*>(file.data() + header->entries_offset);
+        aux = file.data() + header->aux_offset;
+        strings = reinterpret_cast<const char*>(file.data() + header->strings_offset);
+        for (uint64_t i = 0; i < header->count; ++i) {
+            if (entries[i].key_offset > header->strings_size ||
+                entries[i].key_length > header->strings_size - entries[i].key_offset) {
+                return fail(path, "ключ записи выходит за пул строк");
+            }
+        }
+
+        switch (header->kind) {
+            case SNAPSHOT_HASH: {
+                uint64_t bucketCount = header->param;
+                if (bucketCount == 0 || (bucketCount & (bucketCount - 1)) != 0 ||
+                    bucketCount >= auxSize / sizeof(uint64_t)) {
+                    return fail(path, "некорректное число корзин");
+                }
+                const uint64_t* bounds = reinterpret_cast<const uint64_t*>(aux);
+                if (bounds[0] != 0 || bounds[bucketCount] != header->count) return fail(path, "некорректные границы корзин");
+                for (uint64_t b = 0; b < bucketCount; ++b) {
+                    if (bounds[b] > bounds[b + 1]) return fail(path, "некорректные границы корзин");
+                }
+                break;
+            }
+            case SNAPSHOT_SORTED:
+                break;
+            case SNAPSHOT_TREE: {
+                if (header->count == 0) {
+                    if (header->param != ~uint64_t(0)) return fail(path, "некорректный корень дерева");
+                    break;
+                }
+                if (header->param >= header->count) return fail(path, "некорректный корень дерева");
+                if (header->count > auxSize / sizeof(SnapshotTreeLinks)) return fail(path, "неполный массив потомков");
+                // Узлы записаны в прямом порядке обхода, поэтому потомок всегда стоит после родителя:
+                // это исключает и выход за массив, и циклы при спуске.
+                const SnapshotTreeLinks* links = reinterpret_cast<const SnapshotTreeLinks*>(aux);
+                for (uint64_t i = 0; i < header->count; ++i) {
+                    for (uint32_t child : {links[i].left, links[i].right}) {
+                        if (child != SNAPSHOT_NO_CHILD && (child <= i || child >= header->count)) {
+                            return fail(path, "некорректные ссылки на потомков");
+                        }
+                    }
+                }
+                break;
+            }
+            default:
+                return fail(path, "неверный тип индекса");
+        }
+        return true;
+    }
+
+    /// @brief Возвращает число записей в снимке.
+    size_t size() const {
+        return header ? static_cast<size_t>(header->count) : 0;
+    }
+
+    /// @brief Ищет все объекты с заданным ключом непосредственно в отображенном файле.
+    /// @param searchKey Ключ для поиска.
+    /// @return Вектор найденных объектов DataObject.
+    std::vector<DataObject> search(std::string_view searchKey) const {
+        std::vector<DataObject> results;
+        if (!header || header->count == 0) return results;
+
+        switch (header->kind) {
+            case SNAPSHOT_HASH: {
+                uint64_t hash = fnv1a64(searchKey.data(), searchKey.size());
+                const uint64_t* bounds = reinterpret_cast<const uint64_t*>(aux);
+                uint64_t bucket = hash & (header->param - 1);
+                for (uint64_t i = bounds[bucket]; i < bounds[bucket + 1]; ++i) {
+                    if (entries[i].hash == hash && keyOf(entries[i]) == searchKey) {
+                        results.push_back(toObject(entries[i]));
+                    }
+                }
+                break;
+            }
+            case SNAPSHOT_SORTED: {
+                const SnapshotEntry* first = entries;
+                const SnapshotEntry* last = entries + header->count;
+                auto it = std::lower_bound(first, last, searchKey,
+                    [this](const SnapshotEntry& entry, std::string_view key) { return keyOf(entry) < key; });
+                for (; it != last && keyOf(*it) == searchKey; ++it) {
+                    results.push_back(toObject(*it));
+                }
+                break;
+            }
+            case SNAPSHOT_TREE:
+                searchTree(static_cast<uint32_t>(header->param), searchKey, results);
+                break;
+        }
+        return results;
+    }
+};
+
+
+/// @brief Аппаратные счетчики производительности, собираемые PerfCounters.
+enum PerfCounter {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_BRANCH_MISSES,
+    PERF_L1D_MISSES,
+    PERF_LLC_MISSES,
+    PERF_DTLB_MISSES,
+    PERF_COUNTER_COUNT
+};
+
+/// @brief Значения аппаратных счетчиков; -1 означает, что счетчик недоступен.
+using PerfValues = std::array<long long, PERF_COUNTER_COUNT>;
+
+/// @brief Аппаратные счетчики текущего потока через perf_event_open (только Linux).
+/// Каждое событие открывается отдельно, поэтому недоступные на данном процессоре или
+/// в виртуальной машине события просто пропускаются. Значения масштабируются с учетом
+/// мультиплексирования (time_enabled / time_running). На других платформах счетчики недоступны.
+class PerfCounters {
+private:
+    /// @brief Дескрипторы событий; -1 для неоткрытых.
+    int fds[PERF_COUNTER_COUNT];
+
+#ifdef __linux__
+    /// @brief Открывает одно событие для текущего потока (только пространство пользователя).
+    static int openEvent(uint32_t type, uint64_t config) {
+        struct perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+
+    /// @brief Кодирует событие кеша для PERF_TYPE_HW_CACHE: промахи чтения заданного кеша.
+    static uint64_t cacheReadMiss(uint64_t cache) {
+        return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    }
+#endif
+
+public:
+    /// @brief Конструктор: открывает все доступные события.
+    PerfCounters() {
+        for (int& fd : fds) fd = -1;
+#ifdef __linux__
+        fds[PERF_CYCLES] = openEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+        fds[PERF_INSTRUCTIONS] = openEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+        fds[PERF_BRANCH_MISSES] = openEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+        fds[PERF_L1D_MISSES] = openEvent(PERF_TYPE_HW_CACHE, cacheReadMiss(PERF_COUNT_HW_CACHE_L1D));
+        fds[PERF_LLC_MISSES] = openEvent(PERF_TYPE_HW_CACHE, cacheReadMiss(PERF_COUNT_HW_CACHE_LL));
+        fds[PERF_DTLB_MISSES] = openEvent(PERF_TYPE_HW_CACHE, cacheReadMiss(PERF_COUNT_HW_CACHE_DTLB));
+#endif
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    /// @brief Деструктор: закрывает дескрипторы событий.
+    ~PerfCounters() {
+#ifdef __linux__
+        for (int fd : fds) {
+            if (fd >= 0) ::close(fd);
+        }
+#endif
+    }
+
+    /// @brief Возвращает true, если открыт хотя бы один счетчик.
+    bool available() const {
+        for (int fd : fds) {
+            if (fd >= 0) return true;
+        }
+        return false;
+    }
+
+    /// @brief Сбрасывает и запускает счетчики.
+    void start() {
+#ifdef __linux__
+        for (int fd : fds) {
+            if (fd < 0) continue;
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    /// @brief Останавливает счетчики и возвращает накопленные значения.
+    /// @return Значения счетчиков; -1 для недоступных.
+    PerfValues stop() {
+        PerfValues values;
+        values.fill(-1);
+#ifdef __linux__
+        for (int i = 0; i < PERF_COUNTER_COUNT; ++i) {
+            if (fds[i] < 0) continue;
+            ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+            uint64_t data[3] = {0, 0, 0};
+            if (::read(fds[i], data, sizeof(data)) != static_cast<ssize_t>(sizeof(data)) || data[2] == 0) continue;
+            values[i] = static_cast<long long>(static_cast<double>(data[0]) * data[1] / data[2]);
+        }
+#endif
+        return values;
+    }
+
+    /// @brief Выполняет func под счетчиками.
+    /// @tparam Func Тип вызываемой функции без аргументов.
+    /// @param func Измеряемая функция.
+    /// @return Значения счетчиков.
+    template <typename Func>
+    PerfValues measure(Func func) {
+        start();
+        func();
+        return stop();
+    }
+
+    /// @brief Возвращает имя столбца CSV для счетчика.
+    static const char* columnName(int counter) {
+        static const char* const names[PERF_COUNTER_COUNT] = {
+            "Cycles", "Instructions", "Branch_Misses", "L1D_Misses", "LLC_Misses", "dTLB_Misses"
+        };
+        return names[counter];
+    }
+};
+
+
+/// @brief Счетчики страничных отказов процесса.
+struct PageFaultCounts {
+    /// @brief Отказы без обращения к диску (страница уже в кеше ОС).
+    long long minor = 0;
+    /// @brief Отказы с чтением с диска.
+    long long major = 0;
+};
+
+/// @brief Возвращает накопленные счетчики страничных отказов текущего процесса.
+PageFaultCounts readPageFaults() {
+    PageFaultCounts counts;
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (K32GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) {
+        counts.minor = static_cast<long long>(pmc.PageFaultCount);
+    }
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        counts.minor = usage.ru_minflt;
+        counts.major = usage.ru_majflt;
+    }
+#endif
+    return counts;
+}
+
+
+/// @brief Просит ОС вытеснить страницы файла из кеша, чтобы измерить поиск с холодным кешем.
+/// Грязные страницы POSIX_FADV_DONTNEED не вытесняет, поэтому только что записанный файл
+/// сначала сбрасывается на диск (fdatasync). Страницы, отображенные в память процесса, тоже
+/// не вытесняются: вызывать до открытия индекса (mmap).
+/// @param path Путь к файлу.
+void dropFileFromPageCache(const std::string& path) {
+#if !defined(_WIN32) && defined(POSIX_FADV_DONTNEED)
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        fdatasync(fd);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        ::close(fd);
+    }
+#else
+    (void)path;
+#endif
+}
+
+
+/// @brief Размер страницы (корзины) дискового хеш-индекса.
+constexpr size_t DISK_PAGE_SIZE = 4096;
+/// @brief Размер заголовка страницы: номер следующей страницы, число записей, занятые байты.
+constexpr size_t DISK_PAGE_HEADER = 8;
+/// @brief Размер заголовка записи: хеш (8), value1 (4), value2 (8), длина ключа (2).
+constexpr size_t DISK_RECORD_HEADER = 22;
+/// @brief Максимальная длина ключа, помещающегося в страницу.
+constexpr size_t DISK_MAX_KEY_LENGTH = DISK_PAGE_SIZE - DISK_PAGE_HEADER - DISK_RECORD_HEADER;
+
+/// @brief Заголовок файла дискового хеш-индекса (занимает нулевую страницу).
+struct DiskIndexHeader {
+    /// @brief Сигнатура "LAB2DHX".
+    char magic[8];
+    /// @brief Версия формата.
+    uint32_t version;
+    /// @brief Размер страницы.
+    uint32_t page_size;
+    /// @brief Число корзин; корзина b хранится в странице 1 + b.
+    uint64_t bucket_count;
+    /// @brief Число страниц переполнения после основных.
+    uint64_t overflow_pages;
+    /// @brief Число записей.
+    uint64_t record_count;
+};
+
+/// @brief Кодирует запись дискового индекса в буфер.
+/// @param out Буфер, в конец которого добавляется запись.
+/// @param hash FNV-1a хеш ключа.
+/// @param obj Объект.
+inline void appendDiskRecord(std::string& out, uint64_t hash, const DataObject& obj) {
+    uint16_t keyLength = static_cast<uint16_t>(obj.key.size());
+    char header[DISK_RECORD_HEADER];
+    std::memcpy(header, &hash, 8);
+    std::memcpy(header + 8, &obj.value1, 4);
+    std::memcpy(header + 12, &obj.value2, 8);
+    std::memcpy(header + 20, &keyLength, 2);
+    out.append(header, DISK_RECORD_HEADER);
+    out.append(obj.key);
+}
+
+
+/// @brief Построитель дискового хеш-индекса из потока объектов с ограниченным расходом памяти.
+/// Записи раскладываются по временным файлам-разделам, каждый из которых покрывает непрерывный
+/// диапазон корзин и помещается в memoryBudget. Затем разделы по очереди загружаются,
+/// сортируются по корзинам и записываются страницами последовательно; страницы переполнения
+/// собираются в отдельный файл и дописываются в конец.
+class DiskHashIndexBuilder {
+private:
+    std::string path;
+    uint64_t bucket_count;
+    uint64_t buckets_per_partition;
+    uint64_t record_count = 0;
+    std::vector<std::string> partition_paths;
+    std::vector<std::unique_ptr<std::ofstream>> partitions;
+    bool failed = false;
+
+    /// @brief Закрывает и удаляет все оставшиеся файлы разделов (в том числе пустые хвостовые).
+    void removePartitionFiles() {
+        for (auto& partition : partitions) partition->close();
+        for (const auto& partitionPath : partition_paths) std::remove(partitionPath.c_str());
+        partition_paths.clear();
+        partitions.clear();
+    }
+
+public:
+    /// @brief Конструктор.
+    /// @param indexPath Путь к создаваемому файлу индекса.
+    /// @param expectedRecords Ожидаемое число записей (определяет число корзин).
+    /// @param memoryBudget Объем памяти на один раздел при сборке, в байтах.
+    /// @param bytesPerRecordHint Оценка среднего размера записи на странице.
+    DiskHashIndexBuilder(const std::string& indexPath, size_t expectedRecords,
+                         size_t memoryBudget = 256u << 20, size_t bytesPerRecordHint = 32)
+        : path(indexPath) {
+        // Целевое заполнение страниц ~70%, чтобы большинство корзин обходилось без переполнения.
+        uint64_t recordsPerPage = std::max<uint64_t>(1, DISK_PAGE_SIZE * 7 / 10 / bytesPerRecordHint);
+        bucket_count = std::max<uint64_t>(1, (expectedRecords + recordsPerPage - 1) / recordsPerPage);
+        uint64_t totalBytes = static_cast<uint64_t>(expectedRecords) * bytesPerRecordHint;
+        uint64_t partitionCount = std::max<uint64_t>(1, (totalBytes + memoryBudget - 1) / memoryBudget);
+        partitionCount = std::min(partitionCount, bucket_count);
+        buckets_per_partition = (bucket_count + partitionCount - 1) / partitionCount;
+        for (uint64_t p = 0; p < partitionCount; ++p) {
+            partition_paths.push_back(path + ".part" + std::to_string(p));
+            partitions.emplace_back(new std::ofstream(partition_paths.back(), std::ios::binary | std::ios::trunc));
+        }
+    }
+
+    DiskHashIndexBuilder(const DiskHashIndexBuilder&) = delete;
+    DiskHashIndexBuilder& operator=(const DiskHashIndexBuilder&) = delete;
+
+    /// @brief Деструктор: удаляет файлы разделов, если finish не был вызван или не дошел до конца.
+    ~DiskHashIndexBuilder() {
+        removePartitionFiles();
+    }
+
+    /// @brief Добавляет объект в индекс.
+    /// @param obj Объект; ключ должен быть не длиннее DISK_MAX_KEY_LENGTH.
+    void add(const DataObject& obj) {
+        if (obj.key.size() > DISK_MAX_KEY_LENGTH) {
+            std::cerr << "Ключ длиной " << obj.key.size() << " не помещается в страницу дискового индекса" << std::endl;
+            failed = true;
+            return;
+        }
+        uint64_t hash = fnv1a64(obj.key.data(), obj.key.size());
+        uint64_t partition = (hash % bucket_count) / buckets_per_partition;
+        std::string record;
+        appendDiskRecord(record, hash, obj);
+        partitions[partition]->write(record.data(), static_cast<std::streamsize>(record.size()));
+        ++record_count;
+    }
+
+    /// @brief Завершает построение и записывает файл индекса.
+    /// @return true при успехе.
+    bool finish() {
+        for (auto& partition : partitions) partition->close();
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        const std::string overflowPath = path + ".overflow";
+        std::ofstream overflow(overflowPath, std::ios::binary | std::ios::trunc);
+
+        std::vector<char> emptyPage(DISK_PAGE_SIZE, 0);
+        out.write(emptyPage.data(), DISK_PAGE_SIZE);
+
+        const uint64_t firstOverflowPage = 1 + bucket_count;
+        uint64_t overflowPages = 0;
+        std::vector<char> page(DISK_PAGE_SIZE);
+
+        for (size_t p = 0; p < partition_paths.size(); ++p) {
+            uint64_t firstBucket = p * buckets_per_partition;
+            uint64_t lastBucket = std::min(bucket_count, firstBucket + buckets_per_partition);
+            if (firstBucket >= lastBucket) break;
+
+            std::ifstream in(partition_paths[p], std::ios::binary);
+            std::string buffer((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+            in.close();
+            std::remove(partition_paths[p].c_str());
+
+            // Сортировка подсчетом: смещения записей раздела, сгруппированные по корзинам.
+            std::vector<uint64_t> offsets;
+            std::vector<uint32_t> bucketOf;
+            for (size_t pos = 0; pos < buffer.size(); ) {
+                uint64_t hash;
+                uint16_t keyLength;
+                std::memcpy(&hash, buffer.data() + pos, 8);
+                std::memcpy(&keyLength, buffer.data() + pos + 20, 2);
+                offsets.push_back(pos);
+                bucketOf.push_back(static_cast<uint32_t>(hash % bucket_count - firstBucket));
+                pos += DISK_RECORD_HEADER + keyLength;
+            }
+            std::vector<size_t> bounds(lastBucket - firstBucket + 1, 0);
+            for (uint32_t b : bucketOf) bounds[b + 1]++;
+            for (size_t b = 1; b < bounds.size(); ++b) bounds[b] += bounds[b - 1];
+            std::vector<uint64_t> sorted(offsets.size());
+            std::vector<size_t> fill(bounds.begin(), bounds.end() - 1);
+            for (size_t i = 0; i < offsets.size(); ++i) sorted[fill[bucketOf[i]]++] = offsets[i];
+
+            for (uint64_t b = 0; b < lastBucket - firstBucket; ++b) {
+                std::fill(page.begin(), page.end(), 0);
+                bool primary = true;
+                uint16_t recordsInPage = 0;
+                uint16_t used = DISK_PAGE_HEADER;
+
+                auto flushPage = [&](uint32_t nextPage) {
+                    std::memcpy(page.data(), &nextPage, 4);
+                    std::memcpy(page.data() + 4, &recordsInPage, 2);
+                    std::memcpy(page.data() + 6, &used, 2);
+                    (primary ? out : overflow).write(page.data(), DISK_PAGE_SIZE);
+                    std::fill(page.begin(), page.end(), 0);
+                    primary = false;
+                    recordsInPage = 0;
+                    used = DISK_PAGE_HEADER;
+                };
+
+                for (size_t i = bounds[b]; i < bounds[b + 1]; ++i) {
+                    uint16_t keyLength;
+                    std::memcpy(&keyLength, buffer.data() + sorted[i] + 20, 2);
+                    size_t recordSize = DISK_RECORD_HEADER + keyLength;
+                    if (used + recordSize > DISK_PAGE_SIZE) {
+                        flushPage(static_cast<uint32_t>(firstOverflowPage + overflowPages));
+                        ++overflowPages;
+                    }
+                    std::memcpy(page.data() + used, buffer.data() + sorted[i], recordSize);
+                    used = static_cast<uint16_t>(used + recordSize);
+                    ++recordsInPage;
+                }
+                flushPage(0);
+            }
+        }
+
+        overflow.close();
+        // Копирование пустого потока через rdbuf() выставляет failbit у out, и заголовок ниже
+        // не записался бы, поэтому файл переполнения дописывается, только если он не пуст.
+        if (overflowPages > 0) {
+            std::ifstream in(overflowPath, std::ios::binary);
+            out << in.rdbuf();
+        }
+        std::remove(overflowPath.c_str());
+        removePartitionFiles();
+
+        DiskIndexHeader header{};
+        std::memcpy(header.magic, "LAB2DHX", 8);
+        header.version = 1;
+        header.page_size = static_cast<uint32_t>(DISK_PAGE_SIZE);
+        header.bucket_count = bucket_count;
+        header.overflow_pages = overflowPages;
+        header.record_count = record_count;
+        out.seekp(0);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        return !failed && static_cast<bool>(out);
+    }
+};
+
+
+/// @brief Дисковый хеш-индекс: поиск по отображенному в память файлу со страничными корзинами.
+/// В памяти процесса не хранится ничего, кроме отображения: рабочий набор определяется кешем
+/// страниц ОС, поэтому объем данных может превышать объем оперативной памяти.
+class DiskHashIndex {
+private:
+    /// @brief Отображенный файл индекса.
+    MappedFile file;
+    /// @brief Заголовок индекса.
+    DiskIndexHeader header{};
+
+public:
+    /// @brief Открывает индекс и сообщает ОС о случайном характере доступа (madvise).
+    /// @param path Путь к файлу индекса.
+    /// @return true при успехе.
+    bool open(const std::string& path) {
+        if (!file.open(path) || file.size() < DISK_PAGE_SIZE) {
+            std::cerr << "Ошибка открытия дискового индекса " << path << std::endl;
+            return false;
+        }
+        std::memcpy(&header, file.data(), sizeof(header));
+        if (std::memcmp(header.magic, "LAB2DHX", 8) != 0 || header.page_size != DISK_PAGE_SIZE ||
+            (1 + header.bucket_count + header.overflow_pages) * DISK_PAGE_SIZE != file.size()) {
+            std::cerr << "Некорректный файл дискового индекса " << path << std::endl;
+            file.close();
+            return false;
+        }
+#ifndef _WIN32
+        // Доступ к корзинам случаен: отключаем упреждающее чтение соседних страниц.
+        madvise(const_cast<unsigned char*>(file.data()), file.size(), MADV_RANDOM);
+#endif
+        return true;
+    }
+
+    /// @brief Просит ОС заранее подгрузить весь индекс (имеет смысл, если он помещается в память).
+    void prefetchAll() const {
+#ifndef _WIN32
+        madvise(const_cast<unsigned char*>(file.data()), file.size(), MADV_WILLNEED);
+#endif
+    }
+
+    /// @brief Возвращает число записей в индексе.
+    size_t size() const {
+        return static_cast<size_t>(header.record_count);
+    }
+
+    /// @brief Ищет все объекты с заданным ключом.
+    /// @param searchKey Ключ для поиска.
+    /// @return Вектор найденных объектов DataObject. Обычно читается одна страница.
+    std::vector<DataObject> search(std::string_view searchKey) const {
+        std::vector<DataObject> results;
+        if (!file.data()) return results;
+        uint64_t hash = fnv1a64(searchKey.data(), searchKey.size());
+        uint64_t pageNumber = 1 + hash % header.bucket_count;
+        while (pageNumber != 0) {
+            const unsigned char* page = file.data() + pageNumber * DISK_PAGE_SIZE;
+            uint32_t next;
+            uint16_t used;
+            std::memcpy(&next, page, 4);
+            std::memcpy(&used, page + 6, 2);
+            for (size_t pos = DISK_PAGE_HEADER; pos < used; ) {
+                uint64_t recordHash;
+                uint16_t keyLength;
+                std::memcpy(&recordHash, page + pos, 8);
+                std::memcpy(&keyLength, page + pos + 20, 2);
+                std::string_view key(reinterpret_cast<const char*>(page + pos + DISK_RECORD_HEADER), keyLength);
+                if (recordHash == hash && key == searchKey) {
+                    DataObject obj{std::string(key)};
+                    std::memcpy(&obj.value1, page + pos + 8, 4);
+                    std::memcpy(&obj.value2, page + pos + 12, 8);
+                    results.push_back(std::move(obj));
+                }
+                pos += DISK_RECORD_HEADER + keyLength;
+            }
+            pageNumber = next;
+        }
+        return results;
+    }
+};
+
+
+/// @brief Размер блока файла сортированного индекса.
+constexpr size_t SORTED_BLOCK_SIZE = 4096;
+/// @brief Размер заголовка записи сортированного файла: длина ключа (2), value1 (4), value2 (8).
+constexpr size_t SORTED_RECORD_HEADER = 14;
+/// @brief Максимальная длина ключа, помещающегося в блок вместе со счетчиком и одним слотом.
+constexpr size_t SORTED_MAX_KEY_LENGTH = SORTED_BLOCK_SIZE - 4 - SORTED_RECORD_HEADER;
+
+/// @brief Заголовок файла сортированного индекса (занимает первый блок).
+struct SortedFileHeader {
+    /// @brief Сигнатура "LAB2SRT".
+    char magic[8];
+    /// @brief Версия формата.
+    uint32_t version;
+    /// @brief Размер блока.
+    uint32_t block_size;
+    /// @brief Число блоков с данными; блок i хранится по смещению (1 + i) * block_size.
+    uint64_t block_count;
+    /// @brief Число записей.
+    uint64_t record_count;
+    /// @brief Смещение секции разделителей (первых ключей блоков).
+    uint64_t fence_offset;
+    /// @brief Размер секции разделителей в байтах.
+    uint64_t fence_bytes;
+};
+
+/// @brief Кодирует запись сортированного файла (прогона или блока) в буфер.
+/// @param out Буфер, в конец которого добавляется запись.
+/// @param obj Объект.
+inline void appendSortedRecord(std::string& out, const DataObject& obj) {
+    uint16_t keyLength = static_cast<uint16_t>(obj.key.size());
+    char header[SORTED_RECORD_HEADER];
+    std::memcpy(header, &keyLength, 2);
+    std::memcpy(header + 2, &obj.value1, 4);
+    std::memcpy(header + 6, &obj.value2, 8);
+    out.append(header, SORTED_RECORD_HEADER);
+    out.append(obj.key);
+}
+
+/// @brief Возвращает ключ записи сортированного файла без копирования.
+/// @param record Начало записи.
+inline std::string_view sortedRecordKey(const unsigned char* record) {
+    uint16_t keyLength;
+    std::memcpy(&keyLength, record, 2);
+    return std::string_view(reinterpret_cast<const char*>(record + SORTED_RECORD_HEADER), keyLength);
+}
+
+/// @brief Декодирует запись сортированного файла в DataObject.
+/// @param record Начало записи.
+inline DataObject decodeSortedRecord(const unsigned char* record) {
+    DataObject obj{std::string(sortedRecordKey(record))};
+    std::memcpy(&obj.value1, record + 2, 4);
+    std::memcpy(&obj.value2, record + 6, 8);
+    return obj;
+}
+
+
+/// @brief Построитель сортированного файлового индекса внешней сортировкой слиянием.
+/// Объекты накапливаются в памяти до memoryBudget, сортируются и сбрасываются на диск
+/// прогонами; finish() сливает прогоны k-путевым слиянием в блоки фиксированного размера
+/// и записывает в конец файла первый ключ каждого блока (разделители).
+class ExternalSortedIndexBuilder {
+private:
+    std::string path;
+    size_t memory_budget;
+    std::vector<DataObject> buffer;
+    size_t buffered_bytes = 0;
+    std::vector<std::string> run_paths;
+    uint64_t record_count = 0;
+    bool failed = false;
+
+    /// @brief Сортирует накопленные объекты и записывает их очередным прогоном.
+    void spillRun() {
+        if (buffer.empty()) return;
+        std::stable_sort(buffer.begin(), buffer.end());
+        run_paths.push_back(path + ".run" + std::to_string(run_paths.size()));
+        std::ofstream run(run_paths.back(), std::ios::binary | std::ios::trunc);
+        std::string chunk;
+        for (const auto& obj : buffer) {
+            appendSortedRecord(chunk, obj);
+            if (chunk.size() >= (1u << 20)) {
+                run.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+                chunk.clear();
+            }
+        }
+        run.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+        if (!run) failed = true;
+        buffer.clear();
+        buffered_bytes = 0;
+    }
+
+    /// @brief Последовательный читатель прогона для слияния.
+    struct RunReader {
+        std::ifstream in;
+        DataObject current;
+        size_t run_index = 0;
+        bool valid = false;
+
+        /// @brief Читает следующую запись прогона.
+        void next() {
+            char header[SORTED_RECORD_HEADER];
+            valid = static_cast<bool>(in.read(header, SORTED_RECORD_HEADER));
+            if (!valid) return;
+            uint16_t keyLength;
+            std::memcpy(&keyLength, header, 2);
+            std::memcpy(&current.value1, header + 2, 4);
+            std::memcpy(&current.value2, header + 6, 8);
+            current.key.resize(keyLength);
+            valid = static_cast<bool>(in.read(&current.key[0], keyLength));
+        }
+    };
+
+public:
+    /// @brief Конструктор.
+    /// @param indexPath Путь к создаваемому файлу индекса.
+    /// @param memoryBudget Объем памяти под один прогон, в байтах.
+    ExternalSortedIndexBuilder(const std::string& indexPath, size_t memoryBudget = 256u << 20)
+        : path(indexPath), memory_budget(memoryBudget) {}
+
+    /// @brief Добавляет объект в индекс.
+    /// @param obj Объект; ключ должен быть не длиннее SORTED_MAX_KEY_LENGTH.
+    void add(const DataObject& obj) {
+        if (obj.key.size() > SORTED_MAX_KEY_LENGTH) {
+            std::cerr << "Ключ длиной " << obj.key.size() << " не помещается в блок сортированного индекса" << std::endl;
+            failed = true;
+            return;
+        }
+        buffer.push_back(obj);
+        buffered_bytes += sizeof(DataObject) + obj.key.capacity();
+        ++record_count;
+        if (buffered_bytes >= memory_budget) spillRun();
+    }
+
+    /// @brief Возвращает число прогонов, записанных на диск.
+    size_t runCount() const {
+        return run_paths.size();
+    }
+
+    /// @brief Сливает прогоны и записывает файл индекса.
+    /// @return true при успехе.
+    bool finish() {
+        spillRun();
+        std::vector<RunReader> readers(run_paths.size());
+        auto greater = [&readers](size_t a, size_t b) {
+            // При равных ключах первым идет более ранний прогон: слияние устойчиво.
+            if (readers[a].current.key != readers[b].current.key) return readers[b].current.key < readers[a].current.key;
+            return readers[a].run_index > readers[b].run_index;
+        };
+        std::vector<size_t> heap;
+        for (size_t i = 0; i < readers.size(); ++i) {
+            readers[i].in.open(run_paths[i], std::ios::binary);
+            readers[i].run_index = i;
+            readers[i].next();
+            if (readers[i].valid) heap.push_back(i);
+        }
+        std::make_heap(heap.begin(), heap.end(), greater);
+
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        std::vector<char> block(SORTED_BLOCK_SIZE, 0);
+        out.write(block.data(), SORTED_BLOCK_SIZE);
+
+        std::string records;
+        std::vector<uint16_t> slots;
+        std::string fences;
+        uint64_t blockCount = 0;
+
+        // Блок: число записей (2), смещения записей (2 на запись), затем сами записи.
+        auto flushBlock = [&]() {
+            if (slots.empty()) return;
+            std::fill(block.begin(), block.end(), 0);
+            uint16_t count = static_cast<uint16_t>(slots.size());
+            size_t dataStart = 2 + 2 * slots.size();
+            std::memcpy(block.data(), &count, 2);
+            for (size_t i = 0; i < slots.size(); ++i) {
+                uint16_t offset = static_cast<uint16_t>(dataStart + slots[i]);
+                std::memcpy(block.data() + 2 + 2 * i, &offset, 2);
+            }
+            std::memcpy(block.data() + dataStart, records.data(), records.size());
+            out.write(block.data(), SORTED_BLOCK_SIZE);
+
+            std::string_view firstKey = sortedRecordKey(reinterpret_cast<const unsigned char*>(records.data()));
+            uint16_t fenceLength = static_cast<uint16_t>(firstKey.size());
+            fences.append(reinterpret_cast<const char*>(&fenceLength), 2);
+            fences.append(firstKey);
+            records.clear();
+            slots.clear();
+            ++blockCount;
+        };
+
+        while (!heap.empty()) {
+            std::pop_heap(heap.begin(), heap.end(), greater);
+            RunReader& reader = readers[heap.back()];
+            size_t recordSize = SORTED_RECORD_HEADER + reader.current.key.size();
+            if (2 + 2 * (slots.size() + 1) + records.size() + recordSize > SORTED_BLOCK_SIZE) flushBlock();
+            slots.push_back(static_cast<uint16_t>(records.size()));
+            appendSortedRecord(records, reader.current);
+            reader.next();
+            if (reader.valid) {
+                std::push_heap(heap.begin(), heap.end(), greater);
+            } else {
+                heap.pop_back();
+            }
+        }
+        flushBlock();
+
+        for (auto& reader : readers) reader.in.close();
+        for (const auto& runPath : run_paths) std::remove(runPath.c_str());
+
+        SortedFileHeader header{};
+        std::memcpy(header.magic, "LAB2SRT", 8);
+        header.version = 1;
+        header.block_size = static_cast<uint32_t>(SORTED_BLOCK_SIZE);
+        header.block_count = blockCount;
+        header.record_count = record_count;
+        header.fence_offset = (1 + blockCount) * SORTED_BLOCK_SIZE;
+        header.fence_bytes = fences.size();
+        out.write(fences.data(), static_cast<std::streamsize>(fences.size()));
+        out.seekp(0);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        return !failed && static_cast<bool>(out);
+    }
+};
+
+
+/// @brief Статический сортированный файловый индекс.
+/// В памяти хранится только разреженный массив разделителей (первый ключ каждого блока);
+/// поиск находит блок двоичным поиском по разделителям, а затем двоичным поиском по слотам
+/// внутри отображенного блока, так что запрос обычно читает одну страницу файла.
+class SortedFileIndex {
+private:
+    /// @brief Отображенный файл индекса.
+    MappedFile file;
+    /// @brief Заголовок индекса.
+    SortedFileHeader header{};
+    /// @brief Первые ключи блоков (указывают в отображенный файл).
+    std::vector<std::string_view> fences;
+
+    /// @brief Возвращает начало блока с заданным номером.
+    const unsigned char* block(uint64_t index) const {
+        return file.data() + (1 + index) * SORTED_BLOCK_SIZE;
+    }
+
+    /// @brief Возвращает начало записи slot в блоке.
+    static const unsigned char* record(const unsigned char* blockData, size_t slot) {
+        uint16_t offset;
+        std::memcpy(&offset, blockData + 2 + 2 * slot, 2);
+        return blockData + offset;
+    }
+
+    /// @brief Возвращает число записей в блоке.
+    static size_t recordCount(const unsigned char* blockData) {
+        uint16_t count;
+        std::memcpy(&count, blockData, 2);
+        return count;
+    }
+
+public:
+    /// @brief Открывает индекс и загружает разделители блоков.
+    /// @param path Путь к файлу индекса.
+    /// @return true при успехе.
+    bool open(const std::string& path) {
+        fences.clear();
+        if (!file.open(path) || file.size() < SORTED_BLOCK_SIZE) {
+            std::cerr << "Ошибка открытия сортированного индекса " << path << std::endl;
+            return false;
+        }
+        std::memcpy(&header, file.data(), sizeof(header));
+        if (std::memcmp(header.magic, "LAB2SRT", 8) != 0 || header.block_size != SORTED_BLOCK_SIZE ||
+            header.fence_offset != (1 + header.block_count) * SORTED_BLOCK_SIZE ||
+            header.fence_offset + header.fence_bytes != file.size()) {
+            std::cerr << "Некорректный файл сортированного индекса " << path << std::endl;
+            file.close();
+            return false;
+        }
+        fences.reserve(static_cast<size_t>(header.block_count));
+        const unsigned char* pos = file.data() + header.fence_offset;
+        const unsigned char* end = file.data() + file.size();
+        while (pos + 2 <= end) {
+            uint16_t length;
+            std::memcpy(&length, pos, 2);
+            fences.emplace_back(reinterpret_cast<const char*>(pos + 2), length);
+            pos += 2 + length;
+        }
+#ifndef _WIN32
+        madvise(const_cast<unsigned char*>(file.data()), header.fence_offset, MADV_RANDOM);
+#endif
+        return fences.size() == header.block_count;
+    }
+
+    /// @brief Возвращает число записей в индексе.
+    size_t size() const {
+        return static_cast<size_t>(header.record_count);
+    }
+
+    /// @brief Возвращает объем памяти, занятый массивом разделителей, в байтах.
+    size_t fenceMemoryBytes() const {
+        return fences.capacity() * sizeof(std::string_view) + static_cast<size_t>(header.fence_bytes);
+    }
+
+    /// @brief Ищет все объекты с заданным ключом.
+    /// @param searchKey Ключ для поиска.
+    /// @return Вектор найденных объектов DataObject в порядке вставки.
+    std::vector<DataObject> search(std::string_view searchKey) const {
+        std::vector<DataObject> results;
+        if (fences.empty()) return results;
+        // Первый блок, начинающийся с ключа >= searchKey; искомые записи могут начинаться
+        // еще в предыдущем блоке, поэтому поиск стартует с него.
+        uint64_t blockIndex = static_cast<uint64_t>(std::lower_bound(fences.begin(), fences.end(), searchKey) - fences.begin());
+        if (blockIndex > 0) --blockIndex;
+
+        const unsigned char* blockData = block(blockIndex);
+        size_t count = recordCount(blockData);
+        size_t lo = 0, hi = count;
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (sortedRecordKey(record(blockData, mid)) < searchKey) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+
+        for (size_t slot = lo; ; ++slot) {
+            if (slot == count) {
+                if (++blockIndex == header.block_count) break;
+                blockData = block(blockIndex);
+                count = recordCount(blockData);
+                slot = 0;
+            }
+            const unsigned char* rec = record(blockData, slot);
+            if (sortedRecordKey(rec) != searchKey) break;
+            results.push_back(decodeSortedRecord(rec));
+        }
+        return results;
+    }
+};
+
+
+/// @brief Находит первое вхождение любого из двух байтов в диапазоне [pos, end).
+/// Сравнивает по 16 байт за раз (SSE2), хвост проверяется побайтно.
+/// @param pos Начало диапазона.
+/// @param end Конец диапазона.
+/// @param a Первый искомый байт.
+/// @param b Второй искомый байт.
+/// @return Указатель на найденный байт или end.
+inline const char* findEitherByte(const char* pos, const char* end, char a, char b) {
+#if defined(__SSE2__) || defined(_M_X64)
+    const __m128i va = _mm_set1_epi8(a);
+    const __m128i vb = _mm_set1_epi8(b);
+    while (end - pos >= 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, va), _mm_cmpeq_epi8(chunk, vb))));
+        if (mask) return pos + countTrailingZeros(mask);
+        pos += 16;
+    }
+#endif
+    while (pos < end && *pos != a && *pos != b) ++pos;
+    return pos;
+}
+
+/// @brief Статистика загрузки набора данных.
+struct IngestStats {
+    /// @brief Размер прочитанного файла в байтах.
+    size_t bytes = 0;
+    /// @brief Число загруженных записей.
+    size_t records = 0;
+    /// @brief Число пропущенных строк с ошибками формата.
+    size_t bad_lines = 0;
+};
+
+/// @brief Разбирает фрагмент CSV (key,value1,value2 на строку), начинающийся с начала строки.
+/// @param pos Начало фрагмента.
+/// @param end Конец фрагмента (конец строки или файла).
+/// @param out Вектор, в который добавляются объекты.
+/// @return Число строк с ошибками формата.
+size_t parseCsvChunk(const char* pos, const char* end, std::vector<DataObject>& out) {
+    size_t badLines = 0;
+    while (pos < end) {
+        const char* keyEnd = findEitherByte(pos, end, ',', '\n');
+        if (keyEnd == end || *keyEnd == '\n') {
+            // Пустые строки (в том числе "\r\n") пропускаются молча.
+            if (keyEnd - pos > 1 || (keyEnd - pos == 1 && *pos != '\r')) ++badLines;
+            // Последняя строка без перевода строки: keyEnd + 1 указывал бы за конец отображения.
+            if (keyEnd == end) break;
+            pos = keyEnd + 1;
+            continue;
+        }
+        const char* lineEnd = findEitherByte(keyEnd + 1, end, '\n', '\n');
+        const char* valuesEnd = (lineEnd > keyEnd + 1 && lineEnd[-1] == '\r') ? lineEnd - 1 : lineEnd;
+
+        DataObject obj{std::string(pos, keyEnd)};
+        auto first = std::from_chars(keyEnd + 1, valuesEnd, obj.value1);
+        bool ok = first.ec == std::errc() && first.ptr < valuesEnd && *first.ptr == ',';
+        if (ok) {
+            auto second = std::from_chars(first.ptr + 1, valuesEnd, obj.value2);
+            ok = second.ec == std::errc() && second.ptr == valuesEnd;
+        }
+        if (ok) {
+            out.push_back(std::move(obj));
+        } else {
+            ++badLines;
+        }
+        if (lineEnd == end) break;
+        pos = lineEnd + 1;
+    }
+    return badLines;
+}
+
+/// @brief Загружает набор данных из CSV-файла (key,value1,value2; строка заголовка необязательна).
+/// Файл отображается в память и делится на threads фрагментов по границам строк,
+/// которые разбираются параллельно; порядок записей сохраняется.
+/// @param path Путь к файлу.
+/// @param out Вектор, в который добавляются загруженные объекты.
+/// @param threads Число потоков разбора.
+/// @param stats Необязательная статистика загрузки.
+/// @return true при успехе.
+bool loadCsvDataset(const std::string& path, std::vector<DataObject>& out, unsigned threads = 1,
+                    IngestStats* stats = nullptr) {
+    MappedFile file;
+    if (!file.open(path)) {
+        std::cerr << "Ошибка открытия набора данных " << path << std::endl;
+        return false;
+    }
+    const char* begin = reinterpret_cast<const char*>(file.data());
+    const char* end = begin + file.size();
+    if (file.size() >= 4 && std::memcmp(begin, "key,", 4) == 0) {
+        begin = findEitherByte(begin, end, '\n', '\n');
+        if (begin < end) ++begin;
+    }
+#ifndef _WIN32
+    madvise(const_cast<unsigned char*>(file.data()), file.size(), MADV_SEQUENTIAL);
+#endif
+
+    threads = std::max(1u, threads);
+    std::vector<const char*> bounds{begin};
+    for (unsigned t = 1; t < threads; ++t) {
+        const char* split = begin + (end - begin) * t / threads;
+        split = std::max(split, bounds.back());
+        split = findEitherByte(split, end, '\n', '\n');
+        bounds.push_back(split < end ? split + 1 : end);
+    }
+    bounds.push_back(end);
+
+    std::vector<std::vector<DataObject>> parts(threads);
+    std::vector<size_t> badLines(threads, 0);
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < threads; ++t) {
+        workers.emplace_back([&, t]() { badLines[t] = parseCsvChunk(bounds[t], bounds[t + 1], parts[t]); });
+    }
+    badLines[0] = parseCsvChunk(bounds[0], bounds[1], parts[0]);
+    for (auto& worker : workers) worker.join();
+
+    size_t total = 0;
+    for (const auto& part : parts) total += part.size();
+    out.reserve(out.size() + total);
+    for (auto& part : parts) std::move(part.begin(), part.end(), std::back_inserter(out));
+
+    if (stats) {
+        stats->bytes = file.size();
+        stats->records = total;
+        stats->bad_lines = 0;
+        for (size_t bad : badLines) stats->bad_lines += bad;
+    }
+    return true;
+}
+
+/// @brief Записывает набор данных в CSV-файл со строкой заголовка.
+/// @param path Путь к файлу.
+/// @param data Объекты.
+/// @return true при успехе.
+bool writeCsvDataset(const std::string& path, const std::vector<DataObject>& data) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.precision(17);
+    out << "key,value1,value2\n";
+    for (const auto& obj : data) out << obj.key << ',' << obj.value1 << ',' << obj.value2 << '\n';
+    return static_cast<bool>(out);
+}
+
+/// @brief Заголовок компактного двоичного набора данных; за ним следуют записи
+/// в формате сортированного файла (длина ключа, value1, value2, ключ).
+struct DatasetFileHeader {
+    /// @brief Сигнатура "LAB2DAT".
+    char magic[8];
+    /// @brief Версия формата.
+    uint32_t version;
+    /// @brief Зарезервировано.
+    uint32_t reserved;
+    /// @brief Число записей.
+    uint64_t count;
+};
+
+/// @brief Записывает набор данных в компактном двоичном формате.
+/// @param path Путь к файлу.
+/// @param data Объекты.
+/// @return true при успехе.
+bool writeBinaryDataset(const std::string& path, const std::vector<DataObject>& data) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    DatasetFileHeader header{};
+    std::memcpy(header.magic, "LAB2DAT", 8);
+    header.version = 1;
+    header.count = data.size();
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    std::string chunk;
+    for (const auto& obj : data) {
+        appendSortedRecord(chunk, obj);
+        if (chunk.size() >= (1u << 20)) {
+            out.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+            chunk.clear();
+        }
+    }
+    out.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+    return static_cast<bool>(out);
+}
+
+/// @brief Загружает набор данных в компактном двоичном формате через отображение файла.
+/// @param path Путь к файлу.
+/// @param out Вектор, в который добавляются загруженные объекты.
+/// @param stats Необязательная статистика загрузки.
+/// @return true при успехе.
+bool loadBinaryDataset(const std::string& path, std::vector<DataObject>& out, IngestStats* stats = nullptr) {
+    MappedFile file;
+    DatasetFileHeader header{};
+    if (!file.open(path) || file.size() < sizeof(header)) {
+        std::cerr << "Ошибка открытия набора данных " << path << std::endl;
+        return false;
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, "LAB2DAT", 8) != 0 || header.version != 1) {
+        std::cerr << "Некорректный двоичный набор данных " << path << std::endl;
+        return false;
+    }
+#ifndef _WIN32
+    madvise(const_cast<unsigned char*>(file.data()), file.size(), MADV_SEQUENTIAL);
+#endif
+    // Каждая запись занимает не меньше SORTED_RECORD_HEADER байт, поэтому резерв ограничен размером
+    // файла: поврежденный count не должен приводить к огромному выделению до проверки записей.
+    uint64_t max_records = (file.size() - sizeof(header)) / SORTED_RECORD_HEADER;
+    out.reserve(out.size() + static_cast<size_t>(std::min(header.count, max_records)));
+    const unsigned char* pos = file.data() + sizeof(header);
+    const unsigned char* end = file.data() + file.size();
+    for (uint64_t i = 0; i < header.count; ++i) {
+        if (end - pos < static_cast<std::ptrdiff_t>(SORTED_RECORD_HEADER) ||
+            end - pos < static_cast<std::ptrdiff_t>(SORTED_RECORD_HEADER + sortedRecordKey(pos).size())) {
+            std::cerr << "Двоичный набор данных " << path << " обрезан на записи " << i << std::endl;
+            return false;
+        }
+        out.push_back(decodeSortedRecord(pos));
+        pos += SORTED_RECORD_HEADER + sortedRecordKey(pos).size();
+    }
+    if (stats) {
+        stats->bytes = file.size();
+        stats->records = static_cast<size_t>(header.count);
+        stats->bad_lines = 0;
+    }
+    return true;
+}
+
+/// @brief Загружает набор данных, определяя формат по сигнатуре файла (двоичный или CSV).
+/// @param path Путь к файлу.
+/// @param out Вектор, в который добавляются загруженные объекты.
+/// @param threads Число потоков разбора CSV.
+/// @param stats Необязательная статистика загрузки.
+/// @return true при успехе.
+bool loadDataset(const std::string& path, std::vector<DataObject>& out, unsigned threads = 1,
+                 IngestStats* stats = nullptr) {
+    char magic[8] = {};
+    std::ifstream probe(path, std::ios::binary);
+    probe.read(magic, sizeof(magic));
+    probe.close();
+    if (std::memcmp(magic, "LAB2DAT", 8) == 0) return loadBinaryDataset(path, out, stats);
+    return loadCsvDataset(path, out, threads, stats);
+}
+
+
+/// @brief Шаблонная функция для измерения времени выполнения функции в наносекундах.
+/// @tparam Func Тип вызываемой функции (или лямбда-выражения).
+/// @tparam Args Типы аргументов функции.
+/// @param func Функция для измерения.
+/// @param args Аргументы, передаваемые в функцию func.
+/// @return Время выполнения функции в наносекундах (long long).
+template <typename Func, typename... Args>
+long long measureTime(Func func, Args&&... args) {
+    auto start = std::chrono::high_resolution_clock::now();
+    func(std::forward<Args>(args)...);
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+}
+
+/// @brief Номер старшего установленного бита (value != 0).
+inline unsigned highestBit(uint64_t value) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return static_cast<unsigned>(index);
+#else
+    return 63u - static_cast<unsigned>(__builtin_clzll(value));
+#endif
+}
+
+/// @brief Гистограмма задержек с логарифмическими корзинами в духе HdrHistogram.
+/// Значения меньше 2^SUB_BUCKET_BITS хранятся точно; большие значения попадают в корзину
+/// по старшему биту и SUB_BUCKET_BITS следующим за ним битам, поэтому относительная погрешность
+/// не превышает 2^-SUB_BUCKET_BITS (~3%), а запись - это несколько битовых операций и инкремент.
+class LatencyHistogram {
+public:
+    /// @brief Число бит точности внутри одной степени двойки.
+    static constexpr unsigned SUB_BUCKET_BITS = 5;
+    static constexpr size_t SUB_BUCKETS = size_t(1) << SUB_BUCKET_BITS;
+    /// @brief Число корзин: точные значения [0, 32) и по 32 корзины на каждую степень двойки до 2^63.
+    static constexpr size_t BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+    /// @brief Минимальное число значений, при котором p99.9 опирается хотя бы на одно значение хвоста.
+    static constexpr uint64_t MIN_TAIL_SAMPLES = 1000;
+
+private:
+    std::vector<uint64_t> counts = std::vector<uint64_t>(BUCKET_COUNT, 0);
+    uint64_t total = 0;
+    long long max_value = 0;
+
+    static size_t bucketIndex(uint64_t value) {
+        if (value < SUB_BUCKETS) return static_cast<size_t>(value);
+        unsigned shift = highestBit(value) - SUB_BUCKET_BITS;
+        return (shift + 1) * SUB_BUCKETS + static_cast<size_t>((value >> shift) - SUB_BUCKETS);
+    }
+
+public:
+    /// @brief Наименьшее значение, попадающее в корзину.
+    static uint64_t bucketLow(size_t index) {
+        if (index < SUB_BUCKETS) return index;
+        unsigned shift = static_cast<unsigned>(index / SUB_BUCKETS - 1);
+        return static_cast<uint64_t>(index % SUB_BUCKETS + SUB_BUCKETS) << shift;
+    }
+
+    /// @brief Наибольшее значение, попадающее в корзину.
+    static uint64_t bucketHigh(size_t index) {
+        if (index < SUB_BUCKETS) return index;
+        unsigned shift = static_cast<unsigned>(index / SUB_BUCKETS - 1);
+        return bucketLow(index) + ((uint64_t(1) << shift) - 1);
+    }
+
+    /// @brief Записывает одно значение (отрицательные считаются нулем).
+    /// @param value Задержка в наносекундах.
+    void record(long long value) {
+        uint64_t v = value > 0 ? static_cast<uint64_t>(value) : 0;
+        ++counts[bucketIndex(v)];
+        ++total;
+        max_value = std::max(max_value, static_cast<long long>(v));
+    }
+
+    /// @brief Добавляет значения другой гистограммы.
+    void merge(const LatencyHistogram& other) {
+        for (size_t i = 0; i < BUCKET_COUNT; ++i) counts[i] += other.counts[i];
+        total += other.total;
+        max_value = std::max(max_value, other.max_value);
+    }
+
+    /// @brief Число записанных значений.
+    uint64_t count() const {
+        return total;
+    }
+
+    /// @brief Наибольшее записанное значение (точное).
+    long long max() const {
+        return max_value;
+    }
+
+    /// @brief Число значений в корзине.
+    uint64_t bucketCount(size_t index) const {
+        return counts[index];
+    }
+
+    /// @brief Возвращает значение процентиля: верхнюю границу корзины, в которую он попадает.
+    /// @param p Процентиль в диапазоне [0, 100].
+    /// @return Значение процентиля (не больше max()) или 0 для пустой гистограммы.
+    long long percentile(double p) const {
+        if (total == 0) return 0;
+        uint64_t rank = static_cast<uint64_t>(std::ceil(p / 100.0 * static_cast<double>(total)));
+        rank = std::max<uint64_t>(1, std::min(rank, total));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+            seen += counts[i];
+            if (seen >= rank) return std::min(static_cast<long long>(bucketHigh(i)), max_value);
+        }
+        return max_value;
+    }
+};
+
+
+/// @brief Параметры калибровки числа повторений измерения.
+struct CalibrationSettings {
+    /// @brief Минимальное число повторений.
+    int min_iterations = 10;
+    /// @brief Максимальное число повторений.
+    int max_iterations = 10000;
+    /// @brief Целевое суммарное время измерения в наносекундах.
+    long long target_time_ns = 200000000;
+    /// @brief Целевая полуширина 95% доверительного интервала среднего относительно среднего.
+    double target_relative_ci = 0.01;
+};
+
+/// @brief Результат калиброванного измерения.
+struct CalibratedTime {
+    /// @brief Среднее время одного выполнения в наносекундах.
+    long long mean_ns = 0;
+    /// @brief Фактическое число повторений.
+    int iterations = 0;
+    /// @brief Достигнутая относительная полуширина 95% доверительного интервала.
+    double relative_ci = 0.0;
+};
+
+/// @brief Повторяет измерение func, пока не набрано целевое время или целевая точность среднего
+/// (но не меньше min_iterations и не больше max_iterations повторений). Быстрые операции получают
+/// много повторений, а медленные (линейный поиск на больших размерах) - ограниченное время.
+/// @tparam Func Тип вызываемой функции без аргументов.
+/// @param func Функция для измерения.
+/// @param settings Параметры калибровки.
+/// @return Среднее время, число повторений и достигнутая точность.
+template <typename Func>
+CalibratedTime measureCalibrated(Func func, const CalibrationSettings& settings = CalibrationSettings()) {
+    CalibratedTime result;
+    long long total = 0;
+    double mean = 0.0;
+    double m2 = 0.0;
+    auto relativeCi = [&]() {
+        if (result.iterations < 2 || mean <= 0.0) return 0.0;
+        double stddev = std::sqrt(m2 / (result.iterations - 1));
+        return 1.96 * stddev / std::sqrt(static_cast<double>(result.iterations)) / mean;
+    };
+    while (result.iterations < settings.max_iterations) {
+        long long elapsed = measureTime(func);
+        total += elapsed;
+        ++result.iterations;
+        // Алгоритм Уэлфорда: среднее и сумма квадратов отклонений за один проход.
+        double delta = static_cast<double>(elapsed) - mean;
+        mean += delta / result.iterations;
+        m2 += delta * (static_cast<double>(elapsed) - mean);
+        if (result.iterations < settings.min_iterations) continue;
+        if (total >= settings.target_time_ns || relativeCi() <= settings.target_relative_ci) break;
+    }
+    result.mean_ns = result.iterations > 0 ? total / result.iterations : 0;
+    result.relative_ci = relativeCi();
+    return result;
+}
+
+
+/// @brief Измеряет пропускную способность конкурентной таблицы на смешанной нагрузке.
+/// Каждый поток выполняет opsPerThread операций: readPercent% поисков, остальное поровну
+/// вставки и удаления одного объекта по случайному ключу из keys (размер таблицы в среднем постоянен).
+/// @tparam Table Тип таблицы с методами search, insert и eraseOne, безопасными для нескольких потоков.
+/// @param table Таблица, заранее заполненная данными.
+/// @param keys Ключи, из которых выбираются запросы.
+/// @param threads Число потоков.
+/// @param readPercent Доля операций чтения в процентах.
+/// @param opsPerThread Число операций на поток.
+/// @return Пропускная способность в миллионах операций в секунду.
+template <typename Table>
+double measureConcurrentThroughput(Table& table, const std::vector<std::string>& keys,
+                                   unsigned threads, int readPercent, size_t opsPerThread) {
+    std::atomic<bool> start{false};
+    std::atomic<unsigned> ready{0};
+    std::vector<std::thread> workers;
+    workers.reserve(threads);
+
+    for (unsigned t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() {
+            std::mt19937 gen(12345u + t);
+            std::uniform_int_distribution<size_t> key_dist(0, keys.size() - 1);
+            std::uniform_int_distribution<int> op_dist(0, 99);
+            auto anyObject = [](const DataObject&) { return true; };
+            ready.fetch_add(1);
+            while (!start.load(std::memory_order_acquire)) std::this_thread::yield();
+
+            for (size_t i = 0; i < opsPerThread; ++i) {
+                const std::string& key = keys[key_dist(gen)];
+                int op = op_dist(gen);
+                if (op < readPercent) {
+                    volatile auto results = table.search(key);
+                } else if ((op - readPercent) % 2 == 0) {
+                    table.insert(DataObject(key, static_cast<int>(i), 0.0));
+                } else {
+                    table.eraseOne(key, anyObject);
+                }
+            }
+        });
+    }
+
+    while (ready.load() < threads) std::this_thread::yield();
+    auto begin = std::chrono::high_resolution_clock::now();
+    start.store(true, std::memory_order_release);
+    for (auto& worker : workers) worker.join();
+    auto end = std::chrono::high_resolution_clock::now();
+
+    double seconds = std::chrono::duration<double>(end - begin).count();
+    return seconds > 0 ? static_cast<double>(opsPerThread) * threads / seconds / 1e6 : 0.0;
+}
+
+/// @brief Возвращает ряд числа потоков 1, 2, 4, ... до maxThreads включительно.
+/// @param maxThreads Наибольшее число потоков (не меньше 1).
+/// @return Вектор значений числа потоков.
+std::vector<unsigned> threadCountsToBenchmark(unsigned maxThreads) {
+    maxThreads = std::max(1u, maxThreads);
+    std::vector<unsigned> counts;
+    for (unsigned t = 1; t < maxThreads; t *= 2) counts.push_back(t);
+    counts.push_back(maxThreads);
+    return counts;
+}
+
+
+/// @brief Возвращает значение заданного процентиля из отсортированной выборки.
+/// @param sorted Отсортированная по возрастанию выборка.
+/// @param p Процентиль в диапазоне [0, 100].
+/// @return Значение процентиля или 0 для пустой выборки.
+long long percentileOfSorted(const std::vector<long long>& sorted, double p) {
+    if (sorted.empty()) return 0;
+    size_t rank = static_cast<size_t>(p / 100.0 * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[std::min(rank, sorted.size() - 1)];
+}
+
+/// @brief Измеряет задержки чтения, выполняемого в отдельном потоке, пока выполняется rebuild.
+/// @tparam ReadFunc Тип функции void(const std::string&), выполняющей один запрос.
+/// @tparam RebuildFunc Тип функции void(), выполняющей перестройку и возвращающей после ее завершения.
+/// @param keys Ключи запросов.
+/// @param read Функция чтения.
+/// @param rebuild Функция перестройки.
+/// @return Отсортированные задержки запросов в наносекундах.
+template <typename ReadFunc, typename RebuildFunc>
+std::vector<long long> measureReadLatencyDuringRebuild(const std::vector<std::string>& keys,
+                                                       ReadFunc read, RebuildFunc rebuild) {
+    std::atomic<bool> stop{false};
+    std::atomic<bool> started{false};
+    std::vector<long long> latencies;
+    latencies.reserve(1 << 20);
+
+    std::thread reader([&]() {
+        size_t i = 0;
+        started.store(true, std::memory_order_release);
+        while (!stop.load(std::memory_order_acquire)) {
+            const std::string& key = keys[i++ % keys.size()];
+            latencies.push_back(measureTime([&]() { read(key); }));
+        }
+    });
+    while (!started.load(std::memory_order_acquire)) std::this_thread::yield();
+    rebuild();
+    stop.store(true, std::memory_order_release);
+    reader.join();
+
+    std::sort(latencies.begin(), latencies.end());
+    return latencies;
+}
+
+
+/// @brief Вытесняет данные из кешей процессора, проходя с записью по буферу размером
+/// в несколько кешей последнего уровня (по одной записи на строку кеша).
+class CacheEvictor {
+private:
+    std::vector<uint64_t> buffer;
+
+    /// @brief Возвращает размер кеша последнего уровня или 32 МБ, если его не удалось определить.
+    static size_t lastLevelCacheSize() {
+#if !defined(_WIN32) && defined(_SC_LEVEL3_CACHE_SIZE)
+        long llc = sysconf(_SC_LEVEL3_CACHE_SIZE);
+        if (llc > 0) return static_cast<size_t>(llc);
+#endif
+        return 32u << 20;
+    }
+
+public:
+    /// @brief Конструктор: буфер в два размера LLC, в пределах от 64 до 256 МБ
+    /// (верхняя граница ограничивает время вытеснения на серверах с очень большим LLC).
+    CacheEvictor()
+        : buffer(std::min<size_t>(std::max<size_t>(2 * lastLevelCacheSize(), 64u << 20), 256u << 20) / sizeof(uint64_t), 0) {}
+
+    /// @brief Размер буфера в байтах.
+    size_t bytes() const {
+        return buffer.size() * sizeof(uint64_t);
+    }
+
+    /// @brief Проходит по буферу, изменяя по одному слову в каждой строке кеша.
+    void evict() {
+        const size_t stride = 64 / sizeof(uint64_t);
+        for (size_t i = 0; i < buffer.size(); i += stride) buffer[i] += i;
+        volatile uint64_t sink = buffer[buffer.size() / 2];
+        (void)sink;
+    }
+};
+
+
+/// @brief Структурные характеристики движка, не зависящие от запросов.
+struct EngineStats {
+    /// @brief Заполнено ли поле shape (только для деревьев).
+    bool has_shape = false;
+    /// @brief Форма дерева.
+    TreeShape shape;
+    /// @brief Число коллизий при вставке (только для хеш-таблиц).
+    size_t collisions = 0;
+};
+
+/// @brief Общий интерфейс поисковых движков (CRTP). Вызовы разрешаются статически,
+/// поэтому обертка не добавляет виртуального вызова в измеряемый поиск.
+/// Наследник реализует buildImpl, searchImpl и memoryUsageImpl; searchBatchImpl, statsImpl,
+/// countWorkImpl и accepts имеют реализации по умолчанию, которые наследник может заменить своими.
+/// @tparam Derived Класс конкретного движка.
+template <typename Derived>
+class IndexEngine {
+public:
+    /// @brief Проверяет, можно ли измерять движок на наборе данных за разумное время.
+    /// @return true для всех наборов; движки с вырожденными случаями переопределяют проверку.
+    static bool accepts(const std::vector<DataObject>&) {
+        return true;
+    }
+
+    /// @brief Строит индекс по набору данных, заменяя прежнее содержимое.
+    /// @param data Вектор объектов DataObject.
+    void build(const std::vector<DataObject>& data) {
+        derived().buildImpl(data);
+    }
+
+    /// @brief Ищет все объекты с заданным ключом.
+    /// @param key Ключ для поиска.
+    /// @return Вектор найденных объектов.
+    std::vector<DataObject> search(std::string_view key) const {
+        return derived().searchImpl(key);
+    }
+
+    /// @brief Выполняет поиск по каждому ключу пакета.
+    /// @param keys Ключи запросов.
+    /// @return Суммарное число найденных объектов.
+    size_t searchBatch(const std::vector<std::string>& keys) const {
+        return derived().searchBatchImpl(keys);
+    }
+
+    /// @brief Оценивает память, занятую индексом (без служебных данных аллокатора).
+    /// @return Размер в байтах.
+    size_t memoryUsage() const {
+        return derived().memoryUsageImpl();
+    }
+
+    /// @brief Возвращает структурные характеристики индекса.
+    EngineStats stats() const {
+        return derived().statsImpl();
+    }
+
+    /// @brief Подсчитывает работу поиска (узлы, сравнения, байты) по списку ключей.
+    /// @param keys Ключи запросов.
+    /// @param work Накопитель счетчиков.
+    /// @return false, если движок не поддерживает подсчет работы.
+    bool countWork(const std::vector<std::string>& keys, CountingSearchStats& work) const {
+        return derived().countWorkImpl(keys, work);
+    }
+
+protected:
+    size_t searchBatchImpl(const std::vector<std::string>& keys) const {
+        size_t found = 0;
+        for (const auto& key : keys) found += derived().searchImpl(key).size();
+        return found;
+    }
+
+    EngineStats statsImpl() const {
+        return EngineStats();
+    }
+
+    bool countWorkImpl(const std::vector<std::string>&, CountingSearchStats&) const {
+        return false;
+    }
+
+private:
+    const Derived& derived() const {
+        return static_cast<const Derived&>(*this);
+    }
+
+    Derived& derived() {
+        return static_cast<Derived&>(*this);
+    }
+};
+
+/// @brief Оценивает память в куче под одну копию ключей набора данных.
+/// @param data Вектор объектов DataObject.
+/// @return Размер в байтах.
+size_t keyHeapBytes(const std::vector<DataObject>& data) {
+    size_t bytes = 0;
+    for (const auto& obj : data) bytes += stringHeapBytes(obj.key);
+    return bytes;
+}
+
+/// @brief Линейный поиск: индексом служит сам набор данных, построение ничего не копирует.
+class LinearEngine : public IndexEngine<LinearEngine> {
+    friend class IndexEngine<LinearEngine>;
+
+    const std::vector<DataObject>* rows = nullptr;
+
+    void buildImpl(const std::vector<DataObject>& data) {
+        rows = &data;
+    }
+
+    std::vector<DataObject> searchImpl(std::string_view key) const {
+        return linearSearch(*rows, key);
+    }
+
+    size_t memoryUsageImpl() const {
+        return rows ? rows->capacity() * sizeof(DataObject) + keyHeapBytes(*rows) : 0;
+    }
+};
+
+/// @brief Длина самой длинной серии одинаковых ключей в наборе данных.
+/// @param data Вектор объектов DataObject.
+/// @return Максимальное число объектов с одним ключом.
+size_t longestDuplicateRun(const std::vector<DataObject>& data) {
+    std::vector<std::string_view> keys;
+    keys.reserve(data.size());
+    for (const auto& obj : data) keys.push_back(obj.key);
+    std::sort(keys.begin(), keys.end());
+    size_t longest = 0;
+    for (size_t begin = 0, end = 0; begin < keys.size(); begin = end) {
+        while (end < keys.size() && keys[end] == keys[begin]) ++end;
+        longest = std::max(longest, end - begin);
+    }
+    return longest;
+}
+
+/// @brief Несбалансированное бинарное дерево поиска.
+class BSTEngine : public IndexEngine<BSTEngine> {
+    friend class IndexEngine<BSTEngine>;
+
+    /// @brief Предельная длина серии дубликатов. Дубликаты образуют правую цепочку, которую проходит
+    /// каждая следующая вставка того же или большего ключа, поэтому построение квадратично по ее длине:
+    /// zipf_1.1 на 100000 записей (серия около 10^4) строится секунды, на 10^6 (около 10^5) - десятки минут.
+    static constexpr size_t MAX_DUPLICATE_RUN = 1u << 14;
+
+    BSTNode* root = nullptr;
+    size_t count = 0;
+    size_t key_bytes = 0;
+
+    void buildImpl(const std::vector<DataObject>& data) {
+        destroyBST(root);
+        root = nullptr;
+        for (const auto& obj : data) insertBST(root, obj);
+        count = data.size();
+        key_bytes = keyHeapBytes(data);
+    }
+
+    std::vector<DataObject> searchImpl(std::string_view key) const {
+        return searchBST(root, key);
+    }
+
+    size_t memoryUsageImpl() const {
+        return count * sizeof(BSTNode) + key_bytes;
+    }
+
+    EngineStats statsImpl() const {
+        EngineStats stats;
+        stats.has_shape = true;
+        stats.shape = measureTreeShape(static_cast<const BSTNode*>(root));
+        return stats;
+    }
+
+    bool countWorkImpl(const std::vector<std::string>& keys, CountingSearchStats& work) const {
+        for (const auto& key : keys) searchBST(root, key, work);
+        return true;
+    }
+
+public:
+    /// @brief Отклоняет наборы с серией дубликатов длиннее MAX_DUPLICATE_RUN.
+    static bool accepts(const std::vector<DataObject>& data) {
+        return longestDuplicateRun(data) <= MAX_DUPLICATE_RUN;
+    }
+
+    BSTEngine() = default;
+    BSTEngine(const BSTEngine&) = delete;
+    BSTEngine& operator=(const BSTEngine&) = delete;
+
+    ~BSTEngine() {
+        destroyBST(root);
+    }
+};
+
+/// @brief Красно-черное дерево.
+class RBTEngine : public IndexEngine<RBTEngine> {
+    friend class IndexEngine<RBTEngine>;
+
+    RedBlackTree tree;
+    size_t count = 0;
+    size_t key_bytes = 0;
+
+    void buildImpl(const std::vector<DataObject>& data) {
+        tree.build(data);
+        count = data.size();
+        key_bytes = keyHeapBytes(data);
+    }
+
+    std::vector<DataObject> searchImpl(std::string_view key) const {
+        return tree.search(key);
+    }
+
+    size_t memoryUsageImpl() const {
+        return count * sizeof(RBTNode) + key_bytes;
+    }
+
+    EngineStats statsImpl() const {
+        EngineStats stats;
+        stats.has_shape = true;
+        stats.shape = tree.shape();
+        return stats;
+    }
+
+    bool countWorkImpl(const std::vector<std::string>& keys, CountingSearchStats& work) const {
+        for (const auto& key : keys) tree.search(key, work);
+        return true;
+    }
+};
+
+/// @brief Красно-черное дерево с компактными узлами: ключ-ссылка, номер строки и 32-битные индексы.
+class CompactRBTEngine : public IndexEngine<CompactRBTEngine> {
+    friend class IndexEngine<CompactRBTEngine>;
+
+    CompactRedBlackTree<std::string, DataObject> tree;
+
+    void buildImpl(const std::vector<DataObject>& data) {
+        tree.build(data);
+    }
+
+    std::vector<DataObject> searchImpl(std::string_view key) const {
+        return tree.search(key);
+    }
+
+    size_t memoryUsageImpl() const {
+        // Ключи не копируются: узлы ссылаются на строки исходного набора данных.
+        return tree.memoryUsage();
+    }
+
+    EngineStats statsImpl() const {
+        EngineStats stats;
+        stats.has_shape = true;
+        stats.shape = tree.shape();
+        return stats;
+    }
+
+    bool countWorkImpl(const std::vector<std::string>& keys, CountingSearchStats& work) const {
+        for (const auto& key : keys) tree.search(key, work);
+        return true;
+    }
+};
+
+/// @brief Хеш-таблица с цепочками.
+class HashTableEngine : public IndexEngine<HashTableEngine> {
+    friend class IndexEngine<HashTableEngine>;
+
+    HashTable table{0};
+    size_t count = 0;
+    size_t key_bytes = 0;
+
+    void buildImpl(const std::vector<DataObject>& data) {
+        table.build(data);
+        count = data.size();
+        key_bytes = keyHeapBytes(data);
+    }
+
+    std::vector<DataObject> searchImpl(std::string_view key) const {
+        return table.search(key);
+    }
+
+    size_t memoryUsageImpl() const {
+        return table.bucketCount() * sizeof(std::list<HashEntry>) + count * listNodeBytes<HashEntry>() + key_bytes;
+    }
+
+    EngineStats statsImpl() const {
+        EngineStats stats;
+        stats.collisions = table.getCollisionCount();
+        return stats;
+    }
+
+    bool countWorkImpl(const std::vector<std::string>& keys, CountingSearchStats& work) const {
+        for (const auto& key : keys) table.search(key, work);
+        return true;
+    }
+};
+
+/// @brief std::multimap с прозрачным компаратором.
+class MultimapEngine : public IndexEngine<MultimapEngine> {
+    friend class IndexEngine<MultimapEngine>;
+
+    std::multimap<std::string, DataObject, std::less<>> map;
+    size_t key_bytes = 0;
+
+    void buildImpl(const std::vector<DataObject>& data) {
+        map.clear();
+        for (const auto& obj : data) map.insert({obj.key, obj});
+        key_bytes = keyHeapBytes(data);
+    }
+
+    std::vector<DataObject> searchImpl(std::string_view key) const {
+        std::vector<DataObject> results;
+        auto range = map.equal_range(key);
+        for (auto it = range.first; it != range.second; ++it) results.push_back(it->second);
+        return results;
+    }
+
+    size_t memoryUsageImpl() const {
+        // Узел красно-черного дерева libstdc++/MSVC: цвет и три указателя; ключ хранится дважды.
+        return map.size() * (sizeof(std::pair<const std::string, DataObject>) + 4 * sizeof(void*)) + 2 * key_bytes;
+    }
+};
+
+/// @brief Адаптивное поразрядное дерево.
+class ARTEngine : public IndexEngine<ARTEngine> {
+    friend class IndexEngine<ARTEngine>;
+
+    AdaptiveRadixTree tree;
+
+    void buildImpl(const std::vector<DataObject>& data) {
+        tree.build(data);
+    }
+
+    std::vector<DataObject> searchImpl(std::string_view key) const {
+        return tree.search(key);
+    }
+
+    size_t memoryUsageImpl() const {
+        return tree.memoryUsage();
+    }
+};
+
+/// @brief Общее колоночное хранилище строк: ключи подряд в одном буфере со смещениями,
+/// числовые поля - в отдельных массивах. Экономные индексы хранят только ссылку на ключ
+/// (или его отпечаток) и 32-битный номер строки, а DataObject собирают лишь для результатов.
+class RowStore {
+    /// @brief Байты всех ключей подряд.
+    std::string key_bytes;
+    /// @brief Смещения ключей в key_bytes; ключ строки i занимает [key_offsets[i], key_offsets[i + 1]).
+    std::vector<uint32_t> key_offsets{0};
+    /// @brief Столбец value1.
+    std::vector<int> value1;
+    /// @brief Столбец value2.
+    std::vector<double> value2;
+
+public:
+    /// @brief Проверяет, адресуют ли 32-битные номера строк и смещения весь набор данных.
+    /// @param data Вектор объектов DataObject.
+    static bool fits(const std::vector<DataObject>& data) {
+        size_t total = 0;
+        for (const auto& obj : data) total += obj.key.size();
+        return data.size() < UINT32_MAX && total <= UINT32_MAX;
+    }
+
+    /// @brief Заполняет хранилище копией набора данных, заменяя прежнее содержимое.
+    /// @param data Вектор объектов DataObject.
+    /// @return false, если строк или байтов ключей больше, чем адресуют 32-битные номера и смещения.
+    bool build(const std::vector<DataObject>& data) {
+        key_bytes.clear();
+        key_offsets.assign(1, 0);
+        value1.clear();
+        value2.clear();
+        if (!fits(data)) {
+            std::cerr << "Хранилище строк: набор данных не помещается в 32-битные номера строк и смещения" << std::endl;
+            return false;
+        }
+        size_t total = 0;
+        for (const auto& obj : data) total += obj.key.size();
+        key_bytes.reserve(total);
+        key_offsets.reserve(data.size() + 1);
+        value1.reserve(data.size());
+        value2.reserve(data.size());
+        for (const auto& obj : data) {
+            key_bytes += obj.key;
+            key_offsets.push_back(static_cast<uint32_t>(key_bytes.size()));
+            value1.push_back(obj.value1);
+            value2.push_back(obj.value2);
+        }
+        return true;
+    }
+
+    /// @brief Число строк.
+    size_t size() const {
+        return value1.size();
+    }
+
+    /// @brief Ключ строки без копирования; действителен, пока хранилище не перестроено.
+    /// @param row Номер строки.
+    std::string_view key(uint32_t row) const {
+        return std::string_view(key_bytes.data() + key_offsets[row], key_offsets[row + 1] - key_offsets[row]);
+    }
+
+    /// @brief Собирает объект DataObject из столбцов.
+    /// @param row Номер строки.
+    DataObject materialize(uint32_t row) const {
+        return DataObject(std::string(key(row)), value1[row], value2[row]);
+    }
+
+    /// @brief Оценивает память хранилища.
+    /// @return Размер в байтах.
+    size_t memoryUsage() const {
+        return key_bytes.capacity() + key_offsets.capacity() * sizeof(uint32_t)
+             + value1.capacity() * sizeof(int) + value2.capacity() * sizeof(double);
+    }
+};
+
+/// @brief Запись экономного индекса: ссылка на ключ в RowStore и номер строки.
+struct RowRef {
+    std::string_view key;
+    uint32_t row;
+};
+
+/// @brief Запись экономной хеш-таблицы: 32-битный отпечаток ключа и номер строки.
+/// Совпадение отпечатка проверяется сравнением с ключом строки в RowStore.
+struct RowFingerprint {
+    uint32_t key;
+    uint32_t row;
+};
+
+/// @brief Общий интерфейс экономных индексов над RowStore (CRTP). В отличие от IndexEngine,
+/// индекс строится по общему хранилищу, поэтому несколько индексов делят одну копию строк.
+/// Наследник реализует buildImpl, searchRowsImpl и memoryUsageImpl; accepts имеет реализацию
+/// по умолчанию.
+/// @tparam Derived Класс конкретного индекса.
+template <typename Derived>
+class LeanIndex {
+public:
+    /// @brief Проверяет, можно ли измерять индекс на наборе данных за разумное время.
+    /// @return true для всех наборов.
+    static bool accepts(const std::vector<DataObject>&) {
+        return true;
+    }
+
+    /// @brief Строит индекс по хранилищу, заменяя прежнее содержимое.
+    /// @param rows Хранилище строк; должно пережить индекс и не перестраиваться.
+    void build(const RowStore& rows) {
+        store = &rows;
+        derived().buildImpl(rows);
+    }
+
+    /// @brief Ищет номера строк с заданным ключом, не собирая объекты.
+    /// @param key Ключ для поиска.
+    std::vector<uint32_t> searchRows(std::string_view key) const {
+        return derived().searchRowsImpl(key);
+    }
+
+    /// @brief Ищет все объекты с заданным ключом и собирает их из хранилища.
+    /// @param key Ключ для поиска.
+    /// @return Вектор найденных объектов.
+    std::vector<DataObject> search(std::string_view key) const {
+        std::vector<DataObject> results;
+        for (uint32_t row : searchRows(key)) results.push_back(store->materialize(row));
+        return results;
+    }
+
+    /// @brief Оценивает память индекса без общего хранилища строк.
+    /// @return Размер в байтах.
+    size_t memoryUsage() const {
+        return derived().memoryUsageImpl();
+    }
+
+protected:
+    /// @brief Хранилище строк, по которому построен индекс.
+    const RowStore* store = nullptr;
+
+private:
+    const Derived& derived() const {
+        return static_cast<const Derived&>(*this);
+    }
+
+    Derived& derived() {
+        return static_cast<Derived&>(*this);
+    }
+};
+
+/// @brief Извлекает номера строк из найденных записей RowRef.
+inline std::vector<uint32_t> rowsOf(const std::vector<RowRef>& refs) {
+    std::vector<uint32_t> rows;
+    rows.reserve(refs.size());
+    for (const auto& ref : refs) rows.push_back(ref.row);
+    return rows;
+}
+
+/// @brief Экономное бинарное дерево поиска: узел хранит RowRef вместо DataObject.
+class LeanBSTIndex : public LeanIndex<LeanBSTIndex> {
+    friend class LeanIndex<LeanBSTIndex>;
+
+    BasicBSTNode<RowRef>* root = nullptr;
+    size_t count = 0;
+
+    void buildImpl(const RowStore& rows) {
+        destroyBST(root);
+        root = nullptr;
+        for (uint32_t row = 0; row < rows.size(); ++row) insertBST(root, RowRef{rows.key(row), row});
+        count = rows.size();
+    }
+
+    std::vector<uint32_t> searchRowsImpl(std::string_view key) const {
+        return rowsOf(searchBST(root, key));
+    }
+
+    size_t memoryUsageImpl() const {
+        return count * sizeof(BasicBSTNode<RowRef>);
+    }
+
+public:
+    /// @brief Дубликаты образуют ту же правую цепочку, что и в BSTEngine, поэтому и ограничение то же.
+    static bool accepts(const std::vector<DataObject>& data) {
+        return BSTEngine::accepts(data);
+    }
+
+    LeanBSTIndex() = default;
+    LeanBSTIndex(const LeanBSTIndex&) = delete;
+    LeanBSTIndex& operator=(const LeanBSTIndex&) = delete;
+
+    ~LeanBSTIndex() {
+        destroyBST(root);
+    }
+};
+
+/// @brief Экономное красно-черное дерево: узел хранит RowRef вместо DataObject.
+class LeanRBTIndex : public LeanIndex<LeanRBTIndex> {
+    friend class LeanIndex<LeanRBTIndex>;
+
+    using Tree = BasicRedBlackTree<std::string_view, RowRef>;
+
+    Tree tree;
+    size_t count = 0;
+
+    void buildImpl(const RowStore& rows) {
+        tree.build({});  // Очищает дерево.
+        for (uint32_t row = 0; row < rows.size(); ++row) tree.insert(RowRef{rows.key(row), row});
+        count = rows.size();
+    }
+
+    std::vector<uint32_t> searchRowsImpl(std::string_view key) const {
+        return rowsOf(tree.search(key));
+    }
+
+    size_t memoryUsageImpl() const {
+        return count * sizeof(Tree::Node);
+    }
+};
+
+/// @brief Экономная хеш-таблица: элемент цепочки - 32-битный отпечаток ключа и номер строки,
+/// сам ключ читается из хранилища только для проверки совпадения отпечатка.
+class LeanHashIndex : public LeanIndex<LeanHashIndex> {
+    friend class LeanIndex<LeanHashIndex>;
+
+    using Table = BasicHashTable<uint32_t, RowFingerprint>;
+
+    Table table{0};
+    size_t count = 0;
+
+    /// @brief Отпечаток ключа: младшие 32 бита его строкового хеша.
+    static uint32_t fingerprint(std::string_view key) {
+        return static_cast<uint32_t>(KeyHash<std::string>{}(key));
+    }
+
+    void buildImpl(const RowStore& rows) {
+        table = Table(rows.size());
+        for (uint32_t row = 0; row < rows.size(); ++row) table.insert(RowFingerprint{fingerprint(rows.key(row)), row});
+        count = rows.size();
+    }
+
+    std::vector<uint32_t> searchRowsImpl(std::string_view key) const {
+        std::vector<uint32_t> rows;
+        for (const auto& candidate : table.search(fingerprint(key))) {
+            if (store->key(candidate.row) == key) rows.push_back(candidate.row);
+        }
+        return rows;
+    }
+
+    size_t memoryUsageImpl() const {
+        return table.bucketCount() * sizeof(std::list<Table::Entry>) + count * listNodeBytes<Table::Entry>();
+    }
+};
+
+/// @brief Экономный std::multimap: ссылка на ключ в хранилище и номер строки.
+class LeanMultimapIndex : public LeanIndex<LeanMultimapIndex> {
+    friend class LeanIndex<LeanMultimapIndex>;
+
+    std::multimap<std::string_view, uint32_t> map;
+
+    void buildImpl(const RowStore& rows) {
+        map.clear();
+        for (uint32_t row = 0; row < rows.size(); ++row) map.insert({rows.key(row), row});
+    }
+
+    std::vector<uint32_t> searchRowsImpl(std::string_view key) const {
+        std::vector<uint32_t> rows;
+        auto range = map.equal_range(key);
+        for (auto it = range.first; it != range.second; ++it) rows.push_back(it->second);
+        return rows;
+    }
+
+    size_t memoryUsageImpl() const {
+        // Узел красно-черного дерева libstdc++/MSVC: цвет и три указателя.
+        return map.size() * (sizeof(std::pair<const std::string_view, uint32_t>) + 4 * sizeof(void*));
+    }
+};
+
+/// @brief Адаптер экономного индекса к IndexEngine: хранилище строк и индекс над ним.
+/// Позволяет выбирать экономные индексы через --engines и измерять их в основном сравнении
+/// и в режимах кеша; оценка памяти включает хранилище. Хранилище удерживается через shared_ptr,
+/// поэтому несколько адаптеров могут строиться над одной копией строк (buildShared).
+/// @tparam Index Класс экономного индекса, производный от LeanIndex.
+template <typename Index>
+class LeanEngine : public IndexEngine<LeanEngine<Index>> {
+    friend class IndexEngine<LeanEngine<Index>>;
+
+    std::shared_ptr<const RowStore> store;
+    Index lean_index;
+
+    void buildImpl(const std::vector<DataObject>& data) {
+        auto rows = std::make_shared<RowStore>();
+        rows->build(data);  // accepts отклоняет наборы, которые не помещаются в хранилище.
+        buildShared(std::move(rows));
+    }
+
+    std::vector<DataObject> searchImpl(std::string_view key) const {
+        return lean_index.search(key);
+    }
+
+    size_t memoryUsageImpl() const {
+        return (store ? store->memoryUsage() : 0) + lean_index.memoryUsage();
+    }
+
+public:
+    /// @brief Отклоняет наборы, которые не адресуются 32-битными номерами строк и смещениями
+    /// (иначе индекс строился бы по пустому хранилищу и поиск ничего не находил бы).
+    static bool accepts(const std::vector<DataObject>& data) {
+        return RowStore::fits(data) && Index::accepts(data);
+    }
+
+    LeanEngine() = default;
+    // Индекс ссылается на хранилище, удерживаемое этим объектом, поэтому копирование запрещено.
+    LeanEngine(const LeanEngine&) = delete;
+    LeanEngine& operator=(const LeanEngine&) = delete;
+
+    /// @brief Строит индекс по уже заполненному хранилищу, разделяя его с другими владельцами.
+    /// @param rows Хранилище строк.
+    void buildShared(std::shared_ptr<const RowStore> rows) {
+        store = std::move(rows);
+        lean_index.build(*store);
+    }
+
+    /// @brief Хранилище строк, по которому построен индекс.
+    const RowStore& rows() const {
+        return *store;
+    }
+
+    /// @brief Экономный индекс без хранилища.
+    const Index& index() const {
+        return lean_index;
+    }
+};
+
 
-        size_t index = hashFunction(searchKey);
-        if (index >= table_size) return results;
 
-        const auto& bucket = table[index];
-        for (const auto& obj : bucket) {
-            if (obj.key == searchKey) {
-                results.push_back(obj);
-            }
+/// @brief Результаты измерения одного движка на одном наборе данных.
+struct EngineRunResult {
+    /// @brief Движок не измерялся: набор данных отклонен проверкой accepts.
+    bool skipped = false;
+    /// @brief Время построения, нс.
+    long long build_ns = 0;
+    /// @brief Калиброванное время поиска.
+    CalibratedTime search;
+    /// @brief Распределение задержек отдельных поисков по запросам latency_queries.
+    LatencyHistogram histogram;
+    /// @brief Оценка памяти индекса, байт.
+    size_t memory_bytes = 0;
+    /// @brief Структурные характеристики.
+    EngineStats stats;
+    /// @brief Заполнено ли поле work.
+    bool has_work = false;
+    /// @brief Работа поиска по запросам work_queries.
+    CountingSearchStats work;
+    /// @brief Измерены ли аппаратные счетчики.
+    bool has_perf = false;
+    /// @brief Счетчики построения.
+    PerfValues build_perf{};
+    /// @brief Счетчики повторных поисков (search.iterations раз).
+    PerfValues search_perf{};
+};
+
+/// @brief Входные данные одного прогона движка.
+struct EngineBenchmarkInput {
+    const std::vector<DataObject>& data;
+    /// @brief Ключ, по которому калибруется время поиска.
+    const std::string& search_key;
+    /// @brief Ключи для подсчета работы поиска.
+    const std::vector<std::string>& work_queries;
+    /// @brief Ключи для гистограммы задержек.
+    const std::vector<std::string>& latency_queries;
+    const CalibrationSettings& calibration;
+    PerfCounters& perf;
+};
+
+/// @brief Строит движок и измеряет построение, поиск, память и характеристики.
+/// @tparam Engine Класс движка, производный от IndexEngine.
+/// @param input Данные и настройки прогона.
+/// @return Результаты измерений.
+template <typename Engine>
+EngineRunResult benchmarkEngine(const EngineBenchmarkInput& input) {
+    EngineRunResult result;
+    if (!Engine::accepts(input.data)) {
+        result.skipped = true;
+        return result;
+    }
+    Engine engine;
+    result.has_perf = input.perf.available();
+    result.build_ns = measureTime([&]() {
+        if (result.has_perf) {
+            result.build_perf = input.perf.measure([&]() { engine.build(input.data); });
+        } else {
+            engine.build(input.data);
         }
-        return results;
+    });
+    result.search = measureCalibrated([&]() {
+        volatile auto results = engine.search(input.search_key);
+    }, input.calibration);
+    // Гистограмма строится по случайным запросам, а не по повторам калибровочного ключа:
+    // повтор одного ключа попадает в одни и те же кеш-линии и ветви и не показывает хвост.
+    // Не меньше MIN_TAIL_SAMPLES измерений, дальше - пока не исчерпано целевое время калибровки.
+    long long latency_total = 0;
+    for (const auto& key : input.latency_queries) {
+        long long elapsed = measureTime([&]() { volatile auto results = engine.search(key); });
+        result.histogram.record(elapsed);
+        latency_total += elapsed;
+        if (result.histogram.count() >= LatencyHistogram::MIN_TAIL_SAMPLES &&
+            latency_total >= input.calibration.target_time_ns) break;
+    }
+    if (result.has_perf) {
+        std::vector<std::string> batch(static_cast<size_t>(result.search.iterations), input.search_key);
+        result.search_perf = input.perf.measure([&]() {
+            volatile size_t found = engine.searchBatch(batch);
+            (void)found;
+        });
     }
+    result.memory_bytes = engine.memoryUsage();
+    result.stats = engine.stats();
+    result.has_work = engine.countWork(input.work_queries, result.work);
+    return result;
+}
 
-    /// @brief Возвращает количество коллизий, зафиксированных при вставках.
-    /// @return Число коллизий.
-    size_t getCollisionCount() const {
-        return collision_count;
+/// @brief Измеряет среднее время одного поиска по списку запросов в уже построенном индексе.
+/// @tparam Key Тип ключа запроса.
+/// @tparam Search Тип функции поиска по ключу.
+/// @param queries Ключи запросов.
+/// @param search Функция поиска; ее результат сохраняется в volatile, чтобы вызов не был удален.
+/// @param beforeQuery Необязательное действие перед каждым запросом, не входящее в измерение
+/// (например, вытеснение кешей).
+/// @return Среднее время одного поиска, нс.
+template <typename Key, typename Search>
+long long averageSearchTime(const std::vector<Key>& queries, Search search,
+                            const std::function<void()>& beforeQuery = nullptr) {
+    long long total = 0;
+    for (const auto& key : queries) {
+        if (beforeQuery) beforeQuery();
+        total += measureTime([&]() { volatile auto results = search(key); });
     }
+    return total / static_cast<long long>(queries.size());
+}
 
-    /// @brief Строит хеш-таблицу из существующего вектора данных.
-    /// @param data Вектор объектов DataObject.
-    void build(const std::vector<DataObject>& data) {
-        *this = HashTable(data.size());
+/// @brief Строит движок и измеряет среднее время одного поиска по списку запросов.
+/// @tparam Engine Класс движка, производный от IndexEngine.
+/// @param data Набор данных.
+/// @param queries Ключи запросов.
+/// @param beforeQuery Необязательное действие перед каждым запросом, не входящее в измерение.
+/// @return Среднее время одного поиска, нс; -1, если набор данных отклонен проверкой Engine::accepts.
+template <typename Engine>
+long long measureAverageSearch(const std::vector<DataObject>& data, const std::vector<std::string>& queries,
+                               const std::function<void()>& beforeQuery) {
+    if (!Engine::accepts(data)) return -1;
+    Engine engine;
+    engine.build(data);
+    return averageSearchTime(queries, [&](const std::string& key) { return engine.search(key); }, beforeQuery);
+}
 
-        for(const auto& obj : data) {
-            insert(obj);
+/// @brief Запись реестра движков.
+struct EngineRegistration {
+    /// @brief Имя движка: префикс столбцов CSV и значение --engines.
+    const char* name;
+    /// @brief Подпись для вывода в консоль.
+    const char* label;
+    /// @brief Поиск читает весь набор данных (такие движки не измеряются в режимах кеша).
+    bool full_scan;
+    /// @brief Полный прогон движка (benchmarkEngine).
+    EngineRunResult (*benchmark)(const EngineBenchmarkInput&);
+    /// @brief Среднее время поиска по списку запросов (measureAverageSearch).
+    long long (*averageSearch)(const std::vector<DataObject>&, const std::vector<std::string>&,
+                               const std::function<void()>&);
+};
+
+/// @brief Создает запись реестра для класса движка.
+/// @tparam Engine Класс движка, производный от IndexEngine.
+template <typename Engine>
+EngineRegistration registerEngine(const char* name, const char* label, bool fullScan = false) {
+    return {name, label, fullScan, &benchmarkEngine<Engine>, &measureAverageSearch<Engine>};
+}
+
+/// @brief Возвращает реестр всех движков в порядке вывода.
+/// Чтобы добавить движок в сравнение, достаточно добавить сюда одну строку:
+/// столбцы CSV и вывод формируются по реестру.
+const std::vector<EngineRegistration>& engineRegistry() {
+    static const std::vector<EngineRegistration> registry = {
+        registerEngine<LinearEngine>("Linear", "Линейный поиск", true),
+        registerEngine<BSTEngine>("BST", "BST"),
+        registerEngine<RBTEngine>("RBT", "RBT"),
+        registerEngine<CompactRBTEngine>("CompactRBT", "Компактное RBT"),
+        registerEngine<HashTableEngine>("HashTable", "Хеш-таблица"),
+        registerEngine<MultimapEngine>("Multimap", "std::multimap"),
+        registerEngine<ARTEngine>("ART", "ART"),
+        registerEngine<LeanEngine<LeanBSTIndex>>("LeanBST", "Экономное BST"),
+        registerEngine<LeanEngine<LeanRBTIndex>>("LeanRBT", "Экономное RBT"),
+        registerEngine<LeanEngine<LeanHashIndex>>("LeanHashTable", "Экономная хеш-таблица"),
+        registerEngine<LeanEngine<LeanMultimapIndex>>("LeanMultimap", "Экономный std::multimap"),
+    };
+    return registry;
+}
+
+/// @brief Выбирает движки из реестра по списку имен через запятую.
+/// @param names Список имен (пустой список выбирает все движки).
+/// @param selected Выбранные движки в порядке реестра.
+/// @return false, если в списке есть неизвестное имя.
+bool selectEngines(std::string_view names, std::vector<EngineRegistration>& selected) {
+    const auto& registry = engineRegistry();
+    if (names.empty()) {
+        selected = registry;
+        return true;
+    }
+    std::vector<bool> chosen(registry.size(), false);
+    while (!names.empty()) {
+        size_t comma = names.find(',');
+        std::string_view name = names.substr(0, comma);
+        names = comma == std::string_view::npos ? std::string_view() : names.substr(comma + 1);
+        if (name.empty()) continue;
+        auto it = std::find_if(registry.begin(), registry.end(),
+                               [&](const EngineRegistration& engine) { return name == engine.name; });
+        if (it == registry.end()) {
+            std::cerr << "Ошибка: неизвестный движок \"" << name << "\". Доступны:";
+            for (const auto& engine : registry) std::cerr << " " << engine.name;
+            std::cerr << std::endl;
+            return false;
         }
+        chosen[static_cast<size_t>(it - registry.begin())] = true;
+    }
+    selected.clear();
+    for (size_t i = 0; i < registry.size(); ++i) {
+        if (chosen[i]) selected.push_back(registry[i]);
+    }
+    return true;
+}
+
+/// @brief Измеряет среднее время поиска по списку запросов для каждого движка.
+/// @param engines Движки в порядке столбцов.
+/// @param data Набор данных.
+/// @param queries Ключи запросов.
+/// @param beforeQuery Необязательное действие перед каждым запросом, не входящее в измерение.
+/// @return Среднее время одного поиска для каждого движка (нули для пустых данных или запросов,
+/// -1 для движков, отклонивших набор данных).
+std::vector<long long> measureEngineSearchTimes(const std::vector<EngineRegistration>& engines,
+                                                const std::vector<DataObject>& data,
+                                                const std::vector<std::string>& queries,
+                                                const std::function<void()>& beforeQuery = nullptr) {
+    std::vector<long long> times(engines.size(), 0);
+    if (data.empty() || queries.empty()) return times;
+    for (size_t i = 0; i < engines.size(); ++i) times[i] = engines[i].averageSearch(data, queries, beforeQuery);
+    return times;
+}
+
+
+/// @brief Привязывает текущий поток к заданным логическим процессорам.
+/// Потоки, созданные после вызова, наследуют привязку.
+/// @param cpus Номера процессоров.
+/// @return false, если привязка не поддерживается или не удалась.
+bool pinCurrentThread(const std::vector<int>& cpus) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        if (cpu < 0 || cpu >= CPU_SETSIZE) return false;
+        CPU_SET(cpu, &set);
     }
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpus;
+    return false;
+#endif
+}
+
+
+/// @brief Параметры запуска бенчмарка из командной строки.
+struct BenchmarkOptions {
+    /// @brief Размеры наборов данных основного цикла (--sizes).
+    std::vector<size_t> sizes = {100, 300, 500, 1000, 3000, 5000, 10000, 30000, 50000, 100000, 300000, 500000, 1000000};
+    /// @brief Список движков через запятую; пустой - все движки (--engines).
+    std::string engines;
+    /// @brief Профиль данных и запросов основного цикла и режимов кеша (--workload, см. standardDataProfiles).
+    std::string workload = "default";
+    /// @brief Наибольшее число повторений одного поиска (--iterations).
+    int iterations = 10000;
+    /// @brief Наибольшее число потоков; 0 - по числу аппаратных потоков или процессоров --cpus (--threads).
+    unsigned threads = 0;
+    /// @brief Зерно генераторов данных и запросов (--seed).
+    uint64_t seed = 0;
+    /// @brief Задано ли зерно явно; иначе оно берется из std::random_device.
+    bool seed_set = false;
+    /// @brief Каталог для CSV и временных файлов (--output).
+    std::string output_dir = "results";
+    /// @brief Процессоры для привязки потоков; пустой - без привязки (--cpus).
+    std::vector<int> cpus;
+    /// @brief Путь к набору данных (--dataset или позиционный аргумент).
+    std::string dataset_path;
+    /// @brief Выполняемые разделы (см. benchmarkSectionNames); пустой - все разделы (--sections).
+    std::vector<std::string> sections;
+    /// @brief Потолок размеров наборов данных во всех разделах; 0 - без ограничения (--max-size).
+    size_t max_size = 0;
 };
 
+/// @brief Возвращает имена разделов измерений в порядке выполнения.
+/// main - основной цикл по --sizes (search_times_ns, hash_collisions, range_times_ns, mixed_ops_ns,
+/// string_view_lookup_ns, perf_counters, search_work, tree_shape, latency_percentiles); остальные разделы
+/// пишут по одному файлу и используют собственные размеры, ограниченные --max-size.
+const std::vector<std::string>& benchmarkSectionNames() {
+    static const std::vector<std::string> names = {
+        "main", "concurrent", "rebuild", "persistent", "startup", "disk", "external",
+        "ingest", "profile", "cache", "integer", "lean", "generation",
+    };
+    return names;
+}
+
+/// @brief Печатает справку по аргументам командной строки.
+/// @param program Имя программы.
+void printUsage(const char* program) {
+    std::cout << "Использование: " << program << " [параметры] [путь к набору данных]\n"
+                 "  --sizes=N1,N2,...      размеры наборов данных основного цикла\n"
+                 "  --engines=Имя1,...     движки для сравнения:";
+    for (const auto& engine : engineRegistry()) std::cout << " " << engine.name;
+    std::cout << "\n"
+                 "  --workload=ПРОФИЛЬ     профиль ключей и запросов:";
+    for (const auto& profile : standardDataProfiles()) std::cout << " " << profile.name;
+    std::cout << "\n"
+                 "  --iterations=N         наибольшее число повторений одного поиска\n"
+                 "  --threads=N            наибольшее число потоков\n"
+                 "  --seed=N               зерно генераторов данных и запросов\n"
+                 "  --output=КАТАЛОГ       каталог для результатов (по умолчанию results)\n"
+                 "  --cpus=C1,C2,...       привязка потоков к процессорам (Linux); однопоточные\n"
+                 "                         измерения выполняются на первом процессоре списка\n"
+                 "  --dataset=ПУТЬ         набор данных CSV key,value1,value2 или двоичный LAB2DAT\n"
+                 "  --sections=Имя1,...    выполняемые разделы (по умолчанию все):";
+    for (const auto& section : benchmarkSectionNames()) std::cout << " " << section;
+    std::cout << "\n"
+                 "                         --sizes задает размеры только раздела main\n"
+                 "  --max-size=N           потолок размеров наборов данных во всех разделах: большие\n"
+                 "                         размеры заменяются на N (для быстрого прогона)\n"
+                 "  --help                 эта справка\n";
+}
 
-/// @brief Шаблонная функция для измерения времени выполнения функции в наносекундах.
-/// @tparam Func Тип вызываемой функции (или лямбда-выражения).
-/// @tparam Args Типы аргументов функции.
-/// @param func Функция для измерения.
-/// @param args Аргументы, передаваемые в функцию func.
-/// @return Время выполнения функции в наносекундах (long long).
-template <typename Func, typename... Args>
-long long measureTime(Func func, Args&&... args) {
-    auto start = std::chrono::high_resolution_clock::now();
-    func(std::forward<Args>(args)...);
-    auto end = std::chrono::high_resolution_clock::now();
-    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+/// @brief Разбирает список целых чисел через запятую.
+/// @tparam T Целочисленный тип.
+/// @param text Текст списка.
+/// @param values Выходной вектор.
+/// @return false, если список пуст или содержит не число.
+template <typename T>
+bool parseNumberList(std::string_view text, std::vector<T>& values) {
+    values.clear();
+    while (!text.empty()) {
+        size_t comma = text.find(',');
+        std::string_view item = text.substr(0, comma);
+        text = comma == std::string_view::npos ? std::string_view() : text.substr(comma + 1);
+        T value{};
+        auto [end, error] = std::from_chars(item.data(), item.data() + item.size(), value);
+        if (error != std::errc() || end != item.data() + item.size()) return false;
+        values.push_back(value);
+    }
+    return !values.empty();
+}
+
+/// @brief Разбирает аргументы командной строки.
+/// @param argc Количество аргументов.
+/// @param argv Массив аргументов.
+/// @param options Выходные параметры (поля без аргументов сохраняют значения по умолчанию).
+/// @param help Устанавливается в true, если запрошена справка.
+/// @return false при ошибке в аргументах (сообщение выводится в std::cerr).
+bool parseBenchmarkOptions(int argc, char* argv[], BenchmarkOptions& options, bool& help) {
+    help = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            help = true;
+            return true;
+        }
+        if (arg.substr(0, 2) != "--") {
+            options.dataset_path = std::string(arg);
+            continue;
+        }
+        size_t equals = arg.find('=');
+        std::string_view name = arg.substr(0, equals);
+        std::string_view value = equals == std::string_view::npos ? std::string_view() : arg.substr(equals + 1);
+        bool ok = true;
+        if (value.empty()) {
+            ok = false;
+        } else if (name == "--sizes") {
+            ok = parseNumberList(value, options.sizes);
+        } else if (name == "--engines") {
+            options.engines = std::string(value);
+        } else if (name == "--workload") {
+            options.workload = std::string(value);
+        } else if (name == "--iterations") {
+            std::vector<int> values;
+            ok = parseNumberList(value, values) && values.size() == 1 && values[0] > 0;
+            if (ok) options.iterations = values[0];
+        } else if (name == "--threads") {
+            std::vector<unsigned> values;
+            ok = parseNumberList(value, values) && values.size() == 1 && values[0] > 0;
+            if (ok) options.threads = values[0];
+        } else if (name == "--seed") {
+            std::vector<uint64_t> values;
+            ok = parseNumberList(value, values) && values.size() == 1;
+            if (ok) {
+                options.seed = values[0];
+                options.seed_set = true;
+            }
+        } else if (name == "--output") {
+            options.output_dir = std::string(value);
+        } else if (name == "--cpus") {
+            ok = parseNumberList(value, options.cpus);
+        } else if (name == "--dataset") {
+            options.dataset_path = std::string(value);
+        } else if (name == "--sections") {
+            options.sections.clear();
+            const auto& known = benchmarkSectionNames();
+            while (ok && !value.empty()) {
+                size_t comma = value.find(',');
+                std::string section(value.substr(0, comma));
+                value = comma == std::string_view::npos ? std::string_view() : value.substr(comma + 1);
+                ok = std::find(known.begin(), known.end(), section) != known.end();
+                options.sections.push_back(section);
+            }
+        } else if (name == "--max-size") {
+            std::vector<size_t> values;
+            ok = parseNumberList(value, values) && values.size() == 1 && values[0] > 0;
+            if (ok) options.max_size = values[0];
+        } else {
+            std::cerr << "Ошибка: неизвестный параметр " << name << " (см. --help)" << std::endl;
+            return false;
+        }
+        if (!ok) {
+            std::cerr << "Ошибка: неверное значение параметра " << arg << " (см. --help)" << std::endl;
+            return false;
+        }
+    }
+    return true;
 }
 
 
@@ -572,129 +6183,1244 @@ long long measureTime(Func func, Args&&... args) {
 /// @param argv Массив аргументов командной строки.
 /// @return 0 в случае успешного выполнения.
 int main(int argc, char* argv[]) {
+#ifdef _WIN32
     SetConsoleOutputCP(CP_UTF8);
+#endif
 
-    std::vector<size_t> sizes = {100, 300, 500, 1000, 3000, 5000, 10000, 30000, 50000, 100000, 300000, 500000, 1000000};
-    const int SEARCH_ITERATIONS = 10000;
+    BenchmarkOptions options;
+    bool help = false;
+    if (!parseBenchmarkOptions(argc, argv, options, help)) {
+        return 1;
+    }
+    if (help) {
+        printUsage(argv[0]);
+        return 0;
+    }
 
-    std::ofstream time_results_file("results/search_times_ns.csv");
-    std::ofstream collision_results_file("results/hash_collisions.csv");
+    // Разделы выбираются --sections; размеры всех разделов ограничиваются --max-size:
+    // больший размер заменяется потолком, повторы после замены отбрасываются.
+    auto runSection = [&](const char* name) {
+        return options.sections.empty()
+            || std::find(options.sections.begin(), options.sections.end(), name) != options.sections.end();
+    };
+    auto capSize = [&](size_t size) {
+        return options.max_size > 0 ? std::min(size, options.max_size) : size;
+    };
+    auto capSizes = [&](const std::vector<size_t>& list) {
+        std::vector<size_t> capped;
+        for (size_t size : list) {
+            size = capSize(size);
+            if (std::find(capped.begin(), capped.end(), size) == capped.end()) capped.push_back(size);
+        }
+        return capped;
+    };
 
-    time_results_file << "Size,Linear_Search_ns,BST_Search_ns,RBT_Search_ns,HashTable_Search_ns,Multimap_Search_ns\n";
-    collision_results_file << "Size,Collisions\n";
+    std::vector<size_t> sizes = capSizes(options.sizes);
+    const int SEARCH_ITERATIONS = options.iterations;
+    CalibrationSettings calibration;
+    calibration.max_iterations = SEARCH_ITERATIONS;
+    const int RANGE_ITERATIONS = std::min(1000, SEARCH_ITERATIONS);
+    const size_t PREFIX_LENGTH = 2;
+    const size_t RANGE_DISTINCT_KEYS = 100;
+    const int MIXED_OPERATIONS = 1000;
+    const size_t LONG_KEY_SUFFIX = 32;
+    const size_t CONCURRENT_SIZE = capSize(100000);
+    const size_t CONCURRENT_OPS_PER_THREAD = 200000;
+    const int CONCURRENT_READ_PERCENT = 90;
+    const int WRITE_HEAVY_READ_PERCENT = 20;
+    const size_t REBUILD_SIZE = capSize(200000);
+    const std::vector<size_t> persistent_sizes = capSizes({1000, 10000, 100000, 1000000});
+    const int PERSISTENT_VERSIONS = 1000;
+    const std::vector<size_t> snapshot_sizes = capSizes({10000, 100000, 1000000});
+    const std::vector<size_t> disk_sizes = capSizes({10000000, 30000000, 100000000});
+    const size_t DISK_BUILD_MEMORY = 256u << 20;
+    const size_t DISK_LOOKUPS = 10000;
+    const size_t INGEST_SIZE = capSize(1000000);
+    const std::vector<size_t> profile_sizes = capSizes({10000, 100000});
+    const size_t PROFILE_QUERIES = 200;
+    const size_t WORK_QUERIES = 1000;
+    const size_t LATENCY_QUERIES = 10000;
+    const std::vector<size_t> cache_regime_sizes = capSizes({10000, 100000, 1000000});
+    const size_t COLD_QUERIES = 200;
+    const size_t STEADY_QUERIES = 100000;
+    const std::vector<size_t> generation_sizes = capSizes({1000000, 10000000});
+    const std::vector<size_t> integer_key_sizes = capSizes({10000, 100000, 1000000});
+    const std::vector<size_t> lean_sizes = capSizes({10000, 100000, 1000000});
 
-    std::mt19937 gen(std::random_device{}());
+    std::vector<EngineRegistration> engines;
+    if (!selectEngines(options.engines, engines)) {
+        return 1;
+    }
+    std::vector<EngineRegistration> cache_engines;
+    std::copy_if(engines.begin(), engines.end(), std::back_inserter(cache_engines),
+                 [](const EngineRegistration& engine) { return !engine.full_scan; });
 
-    for (size_t size : sizes) {
-        std::cout << "Обрабатываемый размер: " << size << std::endl;
+    const std::vector<DataProfile> profiles = standardDataProfiles();
+    auto workload = std::find_if(profiles.begin(), profiles.end(),
+                                 [&](const DataProfile& profile) { return profile.name == options.workload; });
+    if (workload == profiles.end()) {
+        std::cerr << "Ошибка: неизвестный профиль нагрузки \"" << options.workload << "\" (см. --help)" << std::endl;
+        return 1;
+    }
+    const DataProfile& workload_profile = *workload;
 
-        std::vector<DataObject> data = generateData(size);
-        if (data.empty() && size > 0) {
-            std::cerr << "Предупреждение: Сгенерированы пустые данные для размера " << size << std::endl;
-            time_results_file << size << ",0,0,0,0,0\n";
-            collision_results_file << size << ",0\n";
-            std::cout << "-------------------------------------\n";
-            continue;
+    std::error_code directory_error;
+    std::filesystem::create_directories(options.output_dir, directory_error);
+    if (directory_error) {
+        std::cerr << "Ошибка: не удалось создать каталог " << options.output_dir << ": "
+                  << directory_error.message() << std::endl;
+        return 1;
+    }
+    auto outputPath = [&](const char* name) { return options.output_dir + "/" + name; };
+
+    // Однопоточные измерения выполняются на первом процессоре --cpus; на время многопоточных
+    // разделов поток расширяет привязку до всего списка, чтобы ее унаследовали рабочие потоки.
+    auto pinThreads = [&](bool allCpus) {
+        if (options.cpus.empty()) return;
+        if (!pinCurrentThread(allCpus ? options.cpus : std::vector<int>{options.cpus.front()})) {
+            std::cerr << "Предупреждение: не удалось привязать поток к процессорам --cpus" << std::endl;
         }
-        if (data.empty() && size == 0) {
-             time_results_file << size << ",0,0,0,0,0\n";
-             collision_results_file << size << ",0\n";
-             std::cout << "-------------------------------------\n";
-             continue;
+    };
+    pinThreads(false);
+    const unsigned max_threads = options.threads > 0 ? options.threads
+        : !options.cpus.empty() ? static_cast<unsigned>(options.cpus.size())
+        : std::max(1u, std::thread::hardware_concurrency());
+
+    const uint64_t seed = options.seed_set ? options.seed : std::random_device{}();
+    std::cout << "Зерно: " << seed << ", профиль нагрузки: " << workload_profile.name
+              << ", потоков: до " << max_threads << ", результаты: " << options.output_dir << std::endl;
+    // Данные каждого раздела генерируются из зерна и номера потока данных (обычно размера),
+    // поэтому запуск с тем же --seed воспроизводит те же наборы.
+    auto generateSeeded = [&](size_t size, uint64_t stream, const DataProfile& profile = DataProfile()) {
+        return generateDataParallel(size, profile, seed + stream, max_threads);
+    };
+
+    const std::string& dataset_path = options.dataset_path;
+    std::vector<DataObject> dataset;
+    if (!dataset_path.empty()) {
+        IngestStats stats;
+        if (!loadDataset(dataset_path, dataset, max_threads, &stats)) {
+            return 1;
         }
+        std::cout << "Загружен набор данных " << dataset_path << ": " << stats.records << " записей";
+        if (stats.bad_lines > 0) std::cout << ", пропущено строк с ошибками: " << stats.bad_lines;
+        std::cout << std::endl;
+        sizes.erase(std::remove_if(sizes.begin(), sizes.end(), [&](size_t size) { return size >= dataset.size(); }),
+                    sizes.end());
+        sizes.push_back(dataset.size());
+    }
 
-        std::uniform_int_distribution<> data_idx_dist(0, data.size() - 1);
-        std::string searchKey = data[data_idx_dist(gen)].key;
-        std::cout << "  Поиск по ключу: \"" << searchKey << "\"" << std::endl;
+    std::mt19937 gen(static_cast<std::mt19937::result_type>(seed));
 
-        long long total_linear_time = 0;
-        long long total_bst_time = 0;
-        long long total_rbt_time = 0;
-        long long total_hashtable_time = 0;
-        long long total_multimap_time = 0;
+    if (runSection("main")) {
+        std::ofstream time_results_file(outputPath("search_times_ns.csv"));
+        std::ofstream collision_results_file(outputPath("hash_collisions.csv"));
+        std::ofstream range_results_file(outputPath("range_times_ns.csv"));
+        std::ofstream mixed_results_file(outputPath("mixed_ops_ns.csv"));
+        std::ofstream view_results_file(outputPath("string_view_lookup_ns.csv"));
 
-        for (int i = 0; i < SEARCH_ITERATIONS; ++i) {
-            total_linear_time += measureTime([&]() {
-                volatile auto results = linearSearch(data, searchKey);
-            });
+        // Столбцы основного CSV формируются по выбранным движкам.
+        time_results_file << "Size";
+        for (const char* column : {"_Search_ns", "_Iterations", "_Build_ns", "_Memory_bytes"}) {
+            for (const auto& engine : engines) time_results_file << "," << engine.name << column;
         }
-        long long avg_linear_time = (SEARCH_ITERATIONS > 0) ? total_linear_time / SEARCH_ITERATIONS : 0;
-        std::cout << "  Линейный поиск Среднее время:     " << avg_linear_time << " нс" << std::endl;
-
-        BSTNode* bstRoot = nullptr;
-        measureTime([&]() {
-             for (const auto& obj : data) {
-                 insertBST(bstRoot, obj);
-             }
-         });
+        time_results_file << "\n";
+        std::string empty_time_row;
+        for (size_t i = 0; i < 4 * engines.size(); ++i) empty_time_row += ",0";
+        collision_results_file << "Size,Collisions\n";
+        range_results_file << "Size,Linear_Prefix_ns,RBT_Prefix_ns,Multimap_Prefix_ns,Linear_Range_ns,RBT_Range_ns,Multimap_Range_ns\n";
+        mixed_results_file << "Size,RBT_Mixed_ns,HashTable_Mixed_ns,RBT_Rebuild_ns,HashTable_Rebuild_ns\n";
+        view_results_file << "Size,HashTable_String_ns,HashTable_StringView_ns,RBT_String_ns,RBT_StringView_ns,"
+                             "Multimap_String_ns,Multimap_StringView_ns,HashTable_LongString_ns,HashTable_LongStringView_ns\n";
 
-        for (int i = 0; i < SEARCH_ITERATIONS; ++i) {
-            total_bst_time += measureTime([&]() {
-                volatile auto results = searchBST(bstRoot, searchKey);
-            });
+        // Аппаратные счетчики (Linux, perf_event_open): если они недоступны, файл содержит только заголовок.
+        PerfCounters perf;
+        std::ofstream perf_results_file(outputPath("perf_counters.csv"));
+        perf_results_file << "Size,Engine,Phase,Operations";
+        for (int counter = 0; counter < PERF_COUNTER_COUNT; ++counter) perf_results_file << "," << PerfCounters::columnName(counter);
+        perf_results_file << "\n";
+        if (!perf.available()) {
+            std::cout << "Аппаратные счетчики недоступны (perf_event_open), perf_counters.csv будет пустым" << std::endl;
         }
-        destroyBST(bstRoot);
-        long long avg_bst_time = (SEARCH_ITERATIONS > 0) ? total_bst_time / SEARCH_ITERATIONS : 0;
-        std::cout << "  BST поиск Среднее время:          " << avg_bst_time << " нс" << std::endl;
+        // Записывает значения счетчиков в пересчете на одну операцию.
+        auto recordPerf = [&](size_t size, const char* engine, const char* phase, long long operations,
+                              const PerfValues& values) {
+            perf_results_file << size << "," << engine << "," << phase << "," << operations;
+            for (long long value : values) {
+                perf_results_file << ",";
+                if (value >= 0) perf_results_file << static_cast<double>(value) / operations;
+            }
+            perf_results_file << "\n";
+        };
+
+        // Работа поиска (узлы, сравнения, байты) на запрос и форма деревьев.
+        std::ofstream work_results_file(outputPath("search_work.csv"));
+        std::ofstream shape_results_file(outputPath("tree_shape.csv"));
+        work_results_file << "Size,Engine,Nodes_Visited,Comparisons,Bytes_Compared\n";
+        shape_results_file << "Size,Engine,Height,Avg_Depth,Black_Height\n";
+        auto recordWork = [&](size_t size, const char* engine, const CountingSearchStats& stats, size_t queries) {
+            double count = static_cast<double>(queries);
+            work_results_file << size << "," << engine << "," << stats.nodes_visited / count << ","
+                              << stats.comparisons / count << "," << stats.bytes_compared / count << "\n";
+        };
+        auto recordShape = [&](size_t size, const char* engine, const TreeShape& shape) {
+            shape_results_file << size << "," << engine << "," << shape.height << ","
+                               << shape.average_depth << "," << shape.black_height << "\n";
+        };
+
+        // Распределения задержек случайных запросов (latency_queries): процентили в CSV и непустые корзины гистограмм в JSON.
+        std::ofstream latency_results_file(outputPath("latency_percentiles.csv"));
+        std::ofstream latency_json_file(outputPath("latency_histograms.json"));
+        latency_results_file << "Size,Engine,Count,P50_ns,P90_ns,P99_ns,P99_9_ns,Max_ns\n";
+        latency_json_file << "[";
+        bool first_latency_record = true;
+        auto recordLatency = [&](size_t size, const char* engine, const LatencyHistogram& histogram) {
+            latency_results_file << size << "," << engine << "," << histogram.count() << ","
+                                 << histogram.percentile(50) << "," << histogram.percentile(90) << ","
+                                 << histogram.percentile(99) << "," << histogram.percentile(99.9) << ","
+                                 << histogram.max() << "\n";
+            latency_json_file << (first_latency_record ? "\n" : ",\n")
+                              << "  {\"size\": " << size << ", \"engine\": \"" << engine << "\", \"count\": " << histogram.count()
+                              << ", \"p50\": " << histogram.percentile(50) << ", \"p90\": " << histogram.percentile(90)
+                              << ", \"p99\": " << histogram.percentile(99) << ", \"p99_9\": " << histogram.percentile(99.9)
+                              << ", \"max\": " << histogram.max() << ", \"buckets\": [";
+            bool first_bucket = true;
+            for (size_t i = 0; i < LatencyHistogram::BUCKET_COUNT; ++i) {
+                if (histogram.bucketCount(i) == 0) continue;
+                latency_json_file << (first_bucket ? "" : ", ") << "[" << LatencyHistogram::bucketLow(i) << ", "
+                                  << LatencyHistogram::bucketHigh(i) << ", " << histogram.bucketCount(i) << "]";
+                first_bucket = false;
+            }
+            latency_json_file << "]}";
+            first_latency_record = false;
+        };
 
-        RedBlackTree rbt;
-        measureTime([&]() {
+        for (size_t size : sizes) {
+            std::cout << "Обрабатываемый размер: " << size << std::endl;
+
+            std::vector<DataObject> data = dataset_path.empty()
+                ? generateSeeded(size, size, workload_profile)
+                : std::vector<DataObject>(dataset.begin(), dataset.begin() + size);
+            if (data.empty() && size > 0) {
+                std::cerr << "Предупреждение: Сгенерированы пустые данные для размера " << size << std::endl;
+                time_results_file << size << empty_time_row << "\n";
+                collision_results_file << size << ",0\n";
+                range_results_file << size << ",0,0,0,0,0,0\n";
+                mixed_results_file << size << ",0,0,0,0\n";
+                view_results_file << size << ",0,0,0,0,0,0,0,0\n";
+                std::cout << "-------------------------------------\n";
+                continue;
+            }
+            if (data.empty() && size == 0) {
+                 time_results_file << size << empty_time_row << "\n";
+                 collision_results_file << size << ",0\n";
+                 range_results_file << size << ",0,0,0,0,0,0\n";
+                 mixed_results_file << size << ",0,0,0,0\n";
+                 view_results_file << size << ",0,0,0,0,0,0,0,0\n";
+                 std::cout << "-------------------------------------\n";
+                 continue;
+            }
+
+            std::uniform_int_distribution<> data_idx_dist(0, data.size() - 1);
+            std::string searchKey = data[data_idx_dist(gen)].key;
+            std::vector<std::string> work_queries;
+            work_queries.reserve(WORK_QUERIES);
+            for (size_t i = 0; i < WORK_QUERIES; ++i) work_queries.push_back(data[data_idx_dist(gen)].key);
+            std::vector<std::string> latency_queries;
+            latency_queries.reserve(LATENCY_QUERIES);
+            for (size_t i = 0; i < LATENCY_QUERIES; ++i) latency_queries.push_back(data[data_idx_dist(gen)].key);
+            std::cout << "  Поиск по ключу: \"" << searchKey << "\"" << std::endl;
+
+            EngineBenchmarkInput input{data, searchKey, work_queries, latency_queries, calibration, perf};
+            std::vector<EngineRunResult> runs;
+            runs.reserve(engines.size());
+            for (const auto& engine : engines) {
+                runs.push_back(engine.benchmark(input));
+                const EngineRunResult& run = runs.back();
+                if (run.skipped) {
+                    std::cout << "  " << engine.label << ": пропущен (вырожденный набор данных)" << std::endl;
+                    continue;
+                }
+                std::cout << "  " << engine.label << ": поиск " << run.search.mean_ns << " нс (повторений: "
+                          << run.search.iterations << "), построение " << run.build_ns << " нс, память "
+                          << run.memory_bytes << " байт" << std::endl;
+                if (run.stats.has_shape) {
+                    std::cout << "    Высота / средняя глубина: " << run.stats.shape.height << " / "
+                              << run.stats.shape.average_depth;
+                    if (run.stats.shape.black_height > 0) std::cout << " (черная высота " << run.stats.shape.black_height << ")";
+                    std::cout << std::endl;
+                }
+            }
+
+            // Структуры для сравнений ниже (string_view, диапазоны, смешанная нагрузка): эти разделы
+            // используют операции конкретных структур и не зависят от выбора --engines.
+            RedBlackTree rbt;
             rbt.build(data);
-        });
+            HashTable hashTable(size);
+            hashTable.build(data);
+            size_t collisions = hashTable.getCollisionCount();
+            std::cout << "  Хеш-таблица Коллизии:             " << collisions << std::endl;
+            // std::less<> делает компаратор прозрачным: equal_range и lower_bound принимают std::string_view.
+            std::multimap<std::string, DataObject, std::less<>> multiMap;
+            for (const auto& obj : data) {
+                multiMap.insert({obj.key, obj});
+            }
+
+            // Запрос как срез сетевого буфера: вариант std::string создает ключ на каждый запрос,
+            // вариант std::string_view передает срез напрямую. Короткие ключи помещаются в SSO-буфер
+            // std::string, поэтому отдельно измеряется длинный ключ, для которого копия требует выделения памяти.
+            // Длинный ключ на время замера добавляется в хеш-таблицу (с value1 = -1), чтобы поиск
+            // проходил путь попадания, а не промаха.
+            const std::string longKey = searchKey + std::string(LONG_KEY_SUFFIX, 'x');
+            std::string networkBuffer = "GET " + searchKey + " " + longKey + "\r\n";
+            std::string_view keySlice(networkBuffer.data() + 4, searchKey.size());
+            std::string_view longKeySlice(networkBuffer.data() + 5 + searchKey.size(), longKey.size());
+            hashTable.insert(DataObject(longKey, -1, 0.0));
+
+            long long total_hash_string_time = 0;
+            long long total_hash_view_time = 0;
+            long long total_rbt_string_time = 0;
+            long long total_rbt_view_time = 0;
+            long long total_multimap_string_time = 0;
+            long long total_multimap_view_time = 0;
+            long long total_hash_long_string_time = 0;
+            long long total_hash_long_view_time = 0;
+
+            for (int i = 0; i < SEARCH_ITERATIONS; ++i) {
+                total_hash_string_time += measureTime([&]() {
+                    volatile auto results = hashTable.search(std::string(keySlice));
+                });
+                total_hash_view_time += measureTime([&]() {
+                    volatile auto results = hashTable.search(keySlice);
+                });
+                total_rbt_string_time += measureTime([&]() {
+                    volatile auto results = rbt.search(std::string(keySlice));
+                });
+                total_rbt_view_time += measureTime([&]() {
+                    volatile auto results = rbt.search(keySlice);
+                });
+                total_multimap_string_time += measureTime([&]() {
+                    volatile auto range = multiMap.equal_range(std::string(keySlice));
+                    (void)range;
+                });
+                total_multimap_view_time += measureTime([&]() {
+                    volatile auto range = multiMap.equal_range(keySlice);
+                    (void)range;
+                });
+                total_hash_long_string_time += measureTime([&]() {
+                    volatile auto results = hashTable.search(std::string(longKeySlice));
+                });
+                total_hash_long_view_time += measureTime([&]() {
+                    volatile auto results = hashTable.search(longKeySlice);
+                });
+            }
+            hashTable.eraseOne(longKey, [](const DataObject& obj) { return obj.value1 == -1; });
+            long long avg_hash_string_time = total_hash_string_time / SEARCH_ITERATIONS;
+            long long avg_hash_view_time = total_hash_view_time / SEARCH_ITERATIONS;
+            long long avg_rbt_string_time = total_rbt_string_time / SEARCH_ITERATIONS;
+            long long avg_rbt_view_time = total_rbt_view_time / SEARCH_ITERATIONS;
+            long long avg_multimap_string_time = total_multimap_string_time / SEARCH_ITERATIONS;
+            long long avg_multimap_view_time = total_multimap_view_time / SEARCH_ITERATIONS;
+            long long avg_hash_long_string_time = total_hash_long_string_time / SEARCH_ITERATIONS;
+            long long avg_hash_long_view_time = total_hash_long_view_time / SEARCH_ITERATIONS;
+            std::cout << "  Поиск по срезу буфера (string / string_view): хеш-таблица "
+                      << avg_hash_string_time << " / " << avg_hash_view_time << " нс, RBT "
+                      << avg_rbt_string_time << " / " << avg_rbt_view_time << " нс, std::multimap "
+                      << avg_multimap_string_time << " / " << avg_multimap_view_time << " нс" << std::endl;
+            std::cout << "  Длинный ключ (string / string_view): хеш-таблица "
+                      << avg_hash_long_string_time << " / " << avg_hash_long_view_time << " нс" << std::endl;
+
+            view_results_file << size << ","
+                              << avg_hash_string_time << ","
+                              << avg_hash_view_time << ","
+                              << avg_rbt_string_time << ","
+                              << avg_rbt_view_time << ","
+                              << avg_multimap_string_time << ","
+                              << avg_multimap_view_time << ","
+                              << avg_hash_long_string_time << ","
+                              << avg_hash_long_view_time << "\n";
+
+            // Префиксный и диапазонный поиск: результаты не копируются, а только подсчитываются,
+            // чтобы сравнивать стоимость обхода, а не выделения памяти под вектор.
+            std::string prefix = searchKey.substr(0, PREFIX_LENGTH);
+            std::string rangeLo = searchKey;
+            std::string rangeHi = searchKey;
+            {
+                auto it = multiMap.lower_bound(rangeLo);
+                for (size_t distinct = 0; it != multiMap.end() && distinct < RANGE_DISTINCT_KEYS; ) {
+                    if (it->first != rangeHi) {
+                        rangeHi = it->first;
+                        ++distinct;
+                    }
+                    ++it;
+                }
+            }
+            std::cout << "  Префикс: \"" << prefix << "\", диапазон: [\"" << rangeLo << "\", \"" << rangeHi << "\"]" << std::endl;
+
+            long long total_linear_prefix_time = 0;
+            long long total_rbt_prefix_time = 0;
+            long long total_multimap_prefix_time = 0;
+            long long total_linear_range_time = 0;
+            long long total_rbt_range_time = 0;
+            long long total_multimap_range_time = 0;
+
+            for (int i = 0; i < RANGE_ITERATIONS; ++i) {
+                total_linear_prefix_time += measureTime([&]() {
+                    size_t count = 0;
+                    for (const auto& obj : data) {
+                        if (obj.key.compare(0, prefix.size(), prefix) == 0) ++count;
+                    }
+                    volatile size_t sink = count;
+                    (void)sink;
+                });
+                total_rbt_prefix_time += measureTime([&]() {
+                    size_t count = 0;
+                    for (const auto& obj : rbt.prefixSearch(prefix)) {
+                        (void)obj;
+                        ++count;
+                    }
+                    volatile size_t sink = count;
+                    (void)sink;
+                });
+                total_multimap_prefix_time += measureTime([&]() {
+                    size_t count = 0;
+                    for (auto it = multiMap.lower_bound(prefix);
+                         it != multiMap.end() && it->first.compare(0, prefix.size(), prefix) == 0; ++it) {
+                        ++count;
+                    }
+                    volatile size_t sink = count;
+                    (void)sink;
+                });
+
+                total_linear_range_time += measureTime([&]() {
+                    size_t count = 0;
+                    for (const auto& obj : data) {
+                        if (!(obj.key < rangeLo) && !(rangeHi < obj.key)) ++count;
+                    }
+                    volatile size_t sink = count;
+                    (void)sink;
+                });
+                total_rbt_range_time += measureTime([&]() {
+                    size_t count = 0;
+                    for (const auto& obj : rbt.rangeSearch(rangeLo, rangeHi)) {
+                        (void)obj;
+                        ++count;
+                    }
+                    volatile size_t sink = count;
+                    (void)sink;
+                });
+                total_multimap_range_time += measureTime([&]() {
+                    size_t count = 0;
+                    auto last = multiMap.upper_bound(rangeHi);
+                    for (auto it = multiMap.lower_bound(rangeLo); it != last; ++it) {
+                        ++count;
+                    }
+                    volatile size_t sink = count;
+                    (void)sink;
+                });
+            }
+            long long avg_linear_prefix_time = total_linear_prefix_time / RANGE_ITERATIONS;
+            long long avg_rbt_prefix_time = total_rbt_prefix_time / RANGE_ITERATIONS;
+            long long avg_multimap_prefix_time = total_multimap_prefix_time / RANGE_ITERATIONS;
+            long long avg_linear_range_time = total_linear_range_time / RANGE_ITERATIONS;
+            long long avg_rbt_range_time = total_rbt_range_time / RANGE_ITERATIONS;
+            long long avg_multimap_range_time = total_multimap_range_time / RANGE_ITERATIONS;
+            std::cout << "  Префиксный поиск Среднее время:   линейный " << avg_linear_prefix_time
+                      << " нс, RBT " << avg_rbt_prefix_time
+                      << " нс, std::multimap " << avg_multimap_prefix_time << " нс" << std::endl;
+            std::cout << "  Диапазонный поиск Среднее время:  линейный " << avg_linear_range_time
+                      << " нс, RBT " << avg_rbt_range_time
+                      << " нс, std::multimap " << avg_multimap_range_time << " нс" << std::endl;
+
+            range_results_file << size << ","
+                               << avg_linear_prefix_time << ","
+                               << avg_rbt_prefix_time << ","
+                               << avg_multimap_prefix_time << ","
+                               << avg_linear_range_time << ","
+                               << avg_rbt_range_time << ","
+                               << avg_multimap_range_time << "\n";
 
-        for (int i = 0; i < SEARCH_ITERATIONS; ++i) {
-            total_rbt_time += measureTime([&]() {
-                volatile auto results = rbt.search(searchKey);
+            // Смешанная нагрузка: пакет из MIXED_OPERATIONS операций (50% поиск, 20% вставка,
+            // 20% удаление, 10% upsert) против полной перестройки структуры из вектора.
+            enum MixedOp { MIXED_SEARCH, MIXED_INSERT, MIXED_ERASE, MIXED_UPSERT };
+            std::vector<std::pair<MixedOp, DataObject>> mixedOps;
+            mixedOps.reserve(MIXED_OPERATIONS);
+            for (int i = 0; i < MIXED_OPERATIONS; ++i) {
+                const DataObject& sample = data[data_idx_dist(gen)];
+                int slot = i % 10;
+                MixedOp op = slot < 5 ? MIXED_SEARCH : slot < 7 ? MIXED_INSERT : slot < 9 ? MIXED_ERASE : MIXED_UPSERT;
+                mixedOps.emplace_back(op, DataObject(sample.key, sample.value1 + 1, sample.value2));
+            }
+            auto anyObject = [](const DataObject&) { return true; };
+
+            long long rbt_mixed_time = measureTime([&]() {
+                for (const auto& op : mixedOps) {
+                    switch (op.first) {
+                        case MIXED_SEARCH: { volatile auto results = rbt.search(op.second.key); break; }
+                        case MIXED_INSERT: rbt.insert(op.second); break;
+                        case MIXED_ERASE: rbt.eraseOne(op.second.key, anyObject); break;
+                        case MIXED_UPSERT: rbt.upsert(op.second); break;
+                    }
+                }
+            });
+            long long hashtable_mixed_time = measureTime([&]() {
+                for (const auto& op : mixedOps) {
+                    switch (op.first) {
+                        case MIXED_SEARCH: { volatile auto results = hashTable.search(op.second.key); break; }
+                        case MIXED_INSERT: hashTable.insert(op.second); break;
+                        case MIXED_ERASE: hashTable.eraseOne(op.second.key, anyObject); break;
+                        case MIXED_UPSERT: hashTable.upsert(op.second); break;
+                    }
+                }
+            });
+            long long rbt_rebuild_time = measureTime([&]() {
+                rbt.build(data);
             });
+            long long hashtable_rebuild_time = measureTime([&]() {
+                hashTable.build(data);
+            });
+            std::cout << "  Смешанная нагрузка (" << MIXED_OPERATIONS << " операций): RBT " << rbt_mixed_time
+                      << " нс, хеш-таблица " << hashtable_mixed_time << " нс" << std::endl;
+            std::cout << "  Полная перестройка:               RBT " << rbt_rebuild_time
+                      << " нс, хеш-таблица " << hashtable_rebuild_time << " нс" << std::endl;
+
+            mixed_results_file << size << ","
+                               << rbt_mixed_time << ","
+                               << hashtable_mixed_time << ","
+                               << rbt_rebuild_time << ","
+                               << hashtable_rebuild_time << "\n";
+
+            time_results_file << size;
+            // Пропущенные движки дают пустые ячейки.
+            for (const auto& run : runs) {
+                time_results_file << ",";
+                if (!run.skipped) time_results_file << run.search.mean_ns;
+            }
+            for (const auto& run : runs) {
+                time_results_file << ",";
+                if (!run.skipped) time_results_file << run.search.iterations;
+            }
+            for (const auto& run : runs) {
+                time_results_file << ",";
+                if (!run.skipped) time_results_file << run.build_ns;
+            }
+            for (const auto& run : runs) {
+                time_results_file << ",";
+                if (!run.skipped) time_results_file << run.memory_bytes;
+            }
+            time_results_file << "\n";
+
+            collision_results_file << size << "," << collisions << "\n";
+            for (size_t i = 0; i < engines.size(); ++i) {
+                const EngineRunResult& run = runs[i];
+                if (run.skipped) continue;
+                if (run.has_perf) {
+                    recordPerf(size, engines[i].name, "build", static_cast<long long>(data.size()), run.build_perf);
+                    recordPerf(size, engines[i].name, "search", run.search.iterations, run.search_perf);
+                }
+                if (run.has_work) recordWork(size, engines[i].name, run.work, work_queries.size());
+                if (run.stats.has_shape) recordShape(size, engines[i].name, run.stats.shape);
+                recordLatency(size, engines[i].name, run.histogram);
+            }
+            std::cout << "-------------------------------------\n";
         }
-        long long avg_rbt_time = (SEARCH_ITERATIONS > 0) ? total_rbt_time / SEARCH_ITERATIONS : 0;
-        std::cout << "  RBT поиск Среднее время:          " << avg_rbt_time << " нс" << std::endl;
 
-        HashTable hashTable(size);
-        measureTime([&]() {
-            hashTable.build(data);
-        });
+        time_results_file.close();
+        collision_results_file.close();
+        range_results_file.close();
+        mixed_results_file.close();
+        view_results_file.close();
+        perf_results_file.close();
+        work_results_file.close();
+        shape_results_file.close();
+        latency_results_file.close();
+        latency_json_file << "\n]\n";
+        latency_json_file.close();
+    }
+
+    // Многопоточные разделы: рабочие потоки распределяются по всем процессорам --cpus.
+    pinThreads(true);
+
+    // Многопоточная нагрузка: масштабирование пропускной способности по числу потоков.
+    if (runSection("concurrent")) {
+        std::ofstream concurrent_results_file(outputPath("concurrent_throughput.csv"));
+        concurrent_results_file << "Workload,Engine,Threads,Size,Mops_per_s\n";
+        std::cout << "Многопоточная нагрузка, размер " << CONCURRENT_SIZE << ", чтение "
+                  << CONCURRENT_READ_PERCENT << "%" << std::endl;
+        std::vector<DataObject> data = generateSeeded(CONCURRENT_SIZE, CONCURRENT_SIZE);
+        std::vector<std::string> keys;
+        keys.reserve(data.size());
+        for (const auto& obj : data) keys.push_back(obj.key);
+
+        for (unsigned threads : threadCountsToBenchmark(max_threads)) {
+            ConcurrentHashTable concurrentTable(data.size());
+            concurrentTable.build(data);
+            double mops = measureConcurrentThroughput(concurrentTable, keys, threads,
+                                                      CONCURRENT_READ_PERCENT, CONCURRENT_OPS_PER_THREAD);
+            std::cout << "  ConcurrentHashTable, потоков " << threads << ": " << mops << " млн операций/с" << std::endl;
+            concurrent_results_file << "read_mostly,ConcurrentHashTable," << threads << ","
+                                    << CONCURRENT_SIZE << "," << mops << "\n";
+        }
+
+        std::cout << "Нагрузка с преобладанием записи, чтение " << WRITE_HEAVY_READ_PERCENT << "%" << std::endl;
+        for (unsigned threads : threadCountsToBenchmark(max_threads)) {
+            GlobalLockHashTable globalTable(data.size());
+            globalTable.build(data);
+            double global_mops = measureConcurrentThroughput(globalTable, keys, threads,
+                                                             WRITE_HEAVY_READ_PERCENT, CONCURRENT_OPS_PER_THREAD);
+
+            ShardedHashTable shardedTable(data.size());
+            shardedTable.build(data);
+            double sharded_mops = measureConcurrentThroughput(shardedTable, keys, threads,
+                                                              WRITE_HEAVY_READ_PERCENT, CONCURRENT_OPS_PER_THREAD);
+
+            ConcurrentHashTable concurrentTable(data.size());
+            concurrentTable.build(data);
+            double concurrent_mops = measureConcurrentThroughput(concurrentTable, keys, threads,
+                                                                 WRITE_HEAVY_READ_PERCENT, CONCURRENT_OPS_PER_THREAD);
+
+            std::cout << "  Потоков " << threads << ": глобальная блокировка " << global_mops
+                      << ", ShardedHashTable (" << shardedTable.shardCount() << " сегментов) " << sharded_mops
+                      << ", ConcurrentHashTable " << concurrent_mops << " млн операций/с" << std::endl;
+            concurrent_results_file << "write_heavy,GlobalLockHashTable," << threads << "," << CONCURRENT_SIZE << "," << global_mops << "\n";
+            concurrent_results_file << "write_heavy,ShardedHashTable," << threads << "," << CONCURRENT_SIZE << "," << sharded_mops << "\n";
+            concurrent_results_file << "write_heavy,ConcurrentHashTable," << threads << "," << CONCURRENT_SIZE << "," << concurrent_mops << "\n";
+        }
+        std::cout << "-------------------------------------\n";
+        concurrent_results_file.close();
+    }
+
+    // Задержка чтения во время перестройки: замена версии (VersionedIndex) против
+    // перестройки на месте под блокировкой, при которой читатели ждут ее окончания.
+    if (runSection("rebuild")) {
+        std::ofstream rebuild_results_file(outputPath("rebuild_read_latency.csv"));
+        rebuild_results_file << "Engine,Mode,Reads,P50_ns,P99_ns,Max_ns\n";
+        std::cout << "Чтение во время перестройки, размер " << REBUILD_SIZE << std::endl;
+        std::vector<DataObject> data = generateSeeded(REBUILD_SIZE, REBUILD_SIZE);
+        std::vector<DataObject> nextData = generateSeeded(REBUILD_SIZE, REBUILD_SIZE + 1);
+        std::vector<std::string> keys;
+        keys.reserve(data.size());
+        for (const auto& obj : data) keys.push_back(obj.key);
+
+        auto report = [&](const std::string& engine, const std::string& mode, const std::vector<long long>& latencies) {
+            long long p50 = percentileOfSorted(latencies, 50.0);
+            long long p99 = percentileOfSorted(latencies, 99.0);
+            long long maxLatency = latencies.empty() ? 0 : latencies.back();
+            std::cout << "  " << engine << ", " << mode << ": запросов " << latencies.size()
+                      << ", p50 " << p50 << " нс, p99 " << p99 << " нс, max " << maxLatency << " нс" << std::endl;
+            rebuild_results_file << engine << "," << mode << "," << latencies.size() << ","
+                                 << p50 << "," << p99 << "," << maxLatency << "\n";
+        };
+
+        {
+            VersionedIndex<RedBlackTree> index([](const std::vector<DataObject>& d) {
+                auto tree = std::make_shared<RedBlackTree>();
+                tree->build(d);
+                return tree;
+            }, data);
+            report("RBT", "snapshot_swap", measureReadLatencyDuringRebuild(keys,
+                [&](const std::string& key) { volatile auto results = index.search(key); },
+                [&]() { index.rebuildAsync(nextData); index.waitForRebuild(); }));
+
+            std::shared_mutex lock;
+            RedBlackTree tree;
+            tree.build(data);
+            report("RBT", "in_place_locked", measureReadLatencyDuringRebuild(keys,
+                [&](const std::string& key) {
+                    std::shared_lock<std::shared_mutex> guard(lock);
+                    volatile auto results = tree.search(key);
+                },
+                [&]() {
+                    std::unique_lock<std::shared_mutex> guard(lock);
+                    tree.build(nextData);
+                }));
+        }
+        {
+            VersionedIndex<HashTable> index([](const std::vector<DataObject>& d) {
+                auto table = std::make_shared<HashTable>(d.size());
+                table->build(d);
+                return table;
+            }, data);
+            report("HashTable", "snapshot_swap", measureReadLatencyDuringRebuild(keys,
+                [&](const std::string& key) { volatile auto results = index.search(key); },
+                [&]() { index.rebuildAsync(nextData); index.waitForRebuild(); }));
+
+            std::shared_mutex lock;
+            HashTable table(data.size());
+            table.build(data);
+            report("HashTable", "in_place_locked", measureReadLatencyDuringRebuild(keys,
+                [&](const std::string& key) {
+                    std::shared_lock<std::shared_mutex> guard(lock);
+                    volatile auto results = table.search(key);
+                },
+                [&]() {
+                    std::unique_lock<std::shared_mutex> guard(lock);
+                    table.build(nextData);
+                }));
+        }
+        std::cout << "-------------------------------------\n";
+        rebuild_results_file.close();
+    }
+    pinThreads(false);
+
+    // Персистентное RBT: стоимость вставки с копированием пути и память на одну сохраненную версию.
+    if (runSection("persistent")) {
+        std::ofstream persistent_results_file(outputPath("persistent_rbt.csv"));
+        persistent_results_file << "Size,Mutable_Insert_ns,Persistent_Insert_ns,Bytes_Per_Version,Node_Bytes_Mutable,Node_Bytes_Persistent\n";
+        for (size_t size : persistent_sizes) {
+            std::cout << "Персистентное RBT, размер " << size << std::endl;
+            std::vector<DataObject> data = generateSeeded(size, size);
+            std::vector<DataObject> extra = generateSeeded(PERSISTENT_VERSIONS, size + 1);
+
+            RedBlackTree mutableTree;
+            long long mutable_insert_time = measureTime([&]() {
+                mutableTree.build(data);
+            }) / static_cast<long long>(size);
+
+            PersistentRedBlackTree base;
+            long long persistent_insert_time = measureTime([&]() {
+                base.build(data);
+            }) / static_cast<long long>(size);
+
+            size_t nodesBefore = PersistentRedBlackTree::liveNodeCount();
+            std::vector<PersistentRedBlackTree> versions;
+            versions.reserve(PERSISTENT_VERSIONS);
+            versions.push_back(base);
+            for (int v = 0; v < PERSISTENT_VERSIONS; ++v) {
+                versions.push_back(versions.back().insert(extra[v]));
+            }
+            size_t newNodes = PersistentRedBlackTree::liveNodeCount() - nodesBefore;
+            size_t bytes_per_version = newNodes * sizeof(PRBNode) / PERSISTENT_VERSIONS;
+
+            std::cout << "  Вставка: изменяемое " << mutable_insert_time << " нс, персистентное "
+                      << persistent_insert_time << " нс; память на версию " << bytes_per_version
+                      << " байт (" << newNodes / PERSISTENT_VERSIONS << " новых узлов)" << std::endl;
+            persistent_results_file << size << ","
+                                    << mutable_insert_time << ","
+                                    << persistent_insert_time << ","
+                                    << bytes_per_version << ","
+                                    << sizeof(RBTNode) << ","
+                                    << sizeof(PRBNode) << "\n";
+        }
+        std::cout << "-------------------------------------\n";
+        persistent_results_file.close();
+    }
+
+    // Время старта: построение индексов из данных против загрузки готового снимка
+    // (отображение файла, проверка контрольной суммы и первый запрос).
+    if (runSection("startup")) {
+        std::ofstream startup_results_file(outputPath("startup_times_ns.csv"));
+        startup_results_file << "Size,HashTable_Build_ns,HashTable_Snapshot_ns,Sorted_Build_ns,Sorted_Snapshot_ns,"
+                                "RBT_Build_ns,RBT_Snapshot_ns,Snapshot_Bytes\n";
+        for (size_t size : snapshot_sizes) {
+            std::cout << "Снимки индексов, размер " << size << std::endl;
+            std::vector<DataObject> data = generateSeeded(size, size);
+            const std::string probeKey = data[data.size() / 2].key;
+            const std::string hashPath = outputPath("snapshot_hash.bin");
+            const std::string sortedPath = outputPath("snapshot_sorted.bin");
+            const std::string treePath = outputPath("snapshot_tree.bin");
 
-        for (int i = 0; i < SEARCH_ITERATIONS; ++i) {
-            total_hashtable_time += measureTime([&]() {
-                volatile auto results = hashTable.search(searchKey);
+            long long hash_build_time = measureTime([&]() {
+                HashTable table(data.size());
+                table.build(data);
+                volatile auto results = table.search(probeKey);
             });
+            long long sorted_build_time = measureTime([&]() {
+                std::vector<DataObject> sorted = data;
+                std::stable_sort(sorted.begin(), sorted.end());
+                volatile bool found = std::binary_search(sorted.begin(), sorted.end(), DataObject(probeKey));
+                (void)found;
+            });
+            RedBlackTree tree;
+            long long rbt_build_time = measureTime([&]() {
+                tree.build(data);
+                volatile auto results = tree.search(probeKey);
+            });
+
+            if (!writeHashSnapshot(hashPath, data) || !writeSortedSnapshot(sortedPath, data) || !writeTreeSnapshot(treePath, tree)) {
+                std::cerr << "Предупреждение: не удалось записать снимки для размера " << size << std::endl;
+                continue;
+            }
+
+            auto loadSnapshot = [&](const std::string& path, SnapshotKind kind, size_t& found) {
+                return measureTime([&]() {
+                    IndexSnapshot snapshot;
+                    if (snapshot.open(path, kind)) {
+                        found = snapshot.search(probeKey).size();
+                    }
+                });
+            };
+            size_t hash_found = 0, sorted_found = 0, tree_found = 0;
+            long long hash_snapshot_time = loadSnapshot(hashPath, SNAPSHOT_HASH, hash_found);
+            long long sorted_snapshot_time = loadSnapshot(sortedPath, SNAPSHOT_SORTED, sorted_found);
+            long long rbt_snapshot_time = loadSnapshot(treePath, SNAPSHOT_TREE, tree_found);
+            size_t expected = linearSearch(data, probeKey).size();
+            if (hash_found != expected || sorted_found != expected || tree_found != expected) {
+                std::cerr << "Предупреждение: результаты поиска по снимкам расходятся с данными" << std::endl;
+            }
+
+            size_t snapshot_bytes = 0;
+            {
+                MappedFile mapped;
+                if (mapped.open(hashPath)) snapshot_bytes = mapped.size();
+            }
+            std::remove(hashPath.c_str());
+            std::remove(sortedPath.c_str());
+            std::remove(treePath.c_str());
+
+            std::cout << "  Построение / снимок: хеш-таблица " << hash_build_time << " / " << hash_snapshot_time
+                      << " нс, сортированный массив " << sorted_build_time << " / " << sorted_snapshot_time
+                      << " нс, RBT " << rbt_build_time << " / " << rbt_snapshot_time << " нс" << std::endl;
+            startup_results_file << size << ","
+                                 << hash_build_time << "," << hash_snapshot_time << ","
+                                 << sorted_build_time << "," << sorted_snapshot_time << ","
+                                 << rbt_build_time << "," << rbt_snapshot_time << ","
+                                 << snapshot_bytes << "\n";
         }
-        long long avg_hashtable_time = (SEARCH_ITERATIONS > 0) ? total_hashtable_time / SEARCH_ITERATIONS : 0;
-        size_t collisions = hashTable.getCollisionCount();
-        std::cout << "  Хеш-таблица поиск Среднее время:  " << avg_hashtable_time << " нс" << std::endl;
-        std::cout << "  Хеш-таблица Коллизии:             " << collisions << std::endl;
+        std::cout << "-------------------------------------\n";
+        startup_results_file.close();
+    }
 
-        std::multimap<std::string, DataObject> multiMap;
-        measureTime([&]() {
-             for (const auto& obj : data) {
-                 multiMap.insert({obj.key, obj});
-             }
-         });
+    // Дисковый хеш-индекс на объемах, превышающих оперативную память: данные порождаются
+    // потоком и сразу уходят в построитель, в памяти держится только один раздел.
+    if (runSection("disk")) {
+        std::ofstream disk_results_file(outputPath("disk_index.csv"));
+        disk_results_file << "Size,Build_ns,File_Bytes,Cold_Lookup_ns,Warm_Lookup_ns,"
+                             "Cold_Minor_Faults_per_Lookup,Cold_Major_Faults_per_Lookup\n";
+        for (size_t size : disk_sizes) {
+            std::cout << "Дисковый хеш-индекс, размер " << size << std::endl;
+            const std::string diskPath = outputPath("disk_index.bin");
+            bool built = false;
+            long long build_time = measureTime([&]() {
+                DiskHashIndexBuilder builder(diskPath, size, DISK_BUILD_MEMORY);
+                generateDataStream(size, seed + size, [&](const DataObject& obj) { builder.add(obj); });
+                built = builder.finish();
+            });
+            // Вытеснение до открытия: отображенные страницы ОС из кеша не убирает.
+            if (built) dropFileFromPageCache(diskPath);
+            DiskHashIndex index;
+            if (!built || !index.open(diskPath)) {
+                std::cerr << "Предупреждение: не удалось построить дисковый индекс для размера " << size << std::endl;
+                std::remove(diskPath.c_str());
+                continue;
+            }
+
+            std::mt19937_64 query_gen(seed + size);
+            std::uniform_int_distribution<uint64_t> keyDist(0, std::max<uint64_t>(10, size / 5) - 1);
+            std::vector<std::string> queries;
+            queries.reserve(DISK_LOOKUPS);
+            for (size_t i = 0; i < DISK_LOOKUPS; ++i) queries.push_back(makeSyntheticKey(keyDist(query_gen)));
+
+            auto runLookups = [&]() {
+                size_t found = 0;
+                auto start = std::chrono::high_resolution_clock::now();
+                for (const auto& key : queries) found += index.search(key).size();
+                auto end = std::chrono::high_resolution_clock::now();
+                volatile size_t sink = found;
+                (void)sink;
+                return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() /
+                       static_cast<long long>(queries.size());
+            };
+
+            // Чтение заголовка при открытии подтягивает соседние страницы упреждающим чтением;
+            // повторное вытеснение убирает их (отображенная страница заголовка остается).
+            dropFileFromPageCache(diskPath);
+            PageFaultCounts before = readPageFaults();
+            long long cold_lookup = runLookups();
+            PageFaultCounts after = readPageFaults();
+            long long warm_lookup = runLookups();
+            double minor_per_lookup = static_cast<double>(after.minor - before.minor) / queries.size();
+            double major_per_lookup = static_cast<double>(after.major - before.major) / queries.size();
+
+            MappedFile mapped;
+            size_t file_bytes = mapped.open(diskPath) ? mapped.size() : 0;
+            mapped.close();
+            std::remove(diskPath.c_str());
+
+            std::cout << "  Построение: " << build_time << " нс, файл " << file_bytes << " байт, поиск холодный / теплый: "
+                      << cold_lookup << " / " << warm_lookup << " нс, отказов страниц на поиск: "
+                      << minor_per_lookup << " + " << major_per_lookup << " (с диска)" << std::endl;
+            disk_results_file << size << "," << build_time << "," << file_bytes << ","
+                              << cold_lookup << "," << warm_lookup << ","
+                              << minor_per_lookup << "," << major_per_lookup << "\n";
+        }
+        std::cout << "-------------------------------------\n";
+        disk_results_file.close();
+    }
 
-        for (int i = 0; i < SEARCH_ITERATIONS; ++i) {
-            total_multimap_time += measureTime([&]() {
-                volatile auto range = multiMap.equal_range(searchKey);
+    // Внешняя сортировка слиянием и сортированный файловый индекс на тех же объемах.
+    if (runSection("external")) {
+        std::ofstream external_results_file(outputPath("external_sorted_index.csv"));
+        external_results_file << "Size,Build_ns,Runs,File_Bytes,Fence_Bytes,Cold_Lookup_ns,Warm_Lookup_ns,"
+                                 "Cold_Minor_Faults_per_Lookup,Cold_Major_Faults_per_Lookup\n";
+        for (size_t size : disk_sizes) {
+            std::cout << "Внешняя сортировка, размер " << size << std::endl;
+            const std::string sortedPath = outputPath("external_sorted.bin");
+            bool built = false;
+            size_t runs = 0;
+            long long build_time = measureTime([&]() {
+                ExternalSortedIndexBuilder builder(sortedPath, DISK_BUILD_MEMORY);
+                generateDataStream(size, seed + size, [&](const DataObject& obj) { builder.add(obj); });
+                built = builder.finish();
+                runs = builder.runCount();
             });
+            // Вытеснение до открытия: отображенные страницы ОС из кеша не убирает.
+            if (built) dropFileFromPageCache(sortedPath);
+            SortedFileIndex index;
+            if (!built || !index.open(sortedPath)) {
+                std::cerr << "Предупреждение: не удалось построить сортированный индекс для размера " << size << std::endl;
+                std::remove(sortedPath.c_str());
+                continue;
+            }
+
+            std::mt19937_64 query_gen(seed + size);
+            std::uniform_int_distribution<uint64_t> keyDist(0, std::max<uint64_t>(10, size / 5) - 1);
+            std::vector<std::string> queries;
+            queries.reserve(DISK_LOOKUPS);
+            for (size_t i = 0; i < DISK_LOOKUPS; ++i) queries.push_back(makeSyntheticKey(keyDist(query_gen)));
+
+            auto runLookups = [&]() {
+                size_t found = 0;
+                auto start = std::chrono::high_resolution_clock::now();
+                for (const auto& key : queries) found += index.search(key).size();
+                auto end = std::chrono::high_resolution_clock::now();
+                volatile size_t sink = found;
+                (void)sink;
+                return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() /
+                       static_cast<long long>(queries.size());
+            };
+
+            // Чтение заголовка и разделителей при открытии подтягивает соседние страницы упреждающим
+            // чтением; повторное вытеснение убирает их (отображенные страницы разделителей остаются).
+            dropFileFromPageCache(sortedPath);
+            PageFaultCounts before = readPageFaults();
+            long long cold_lookup = runLookups();
+            PageFaultCounts after = readPageFaults();
+            long long warm_lookup = runLookups();
+            double minor_per_lookup = static_cast<double>(after.minor - before.minor) / queries.size();
+            double major_per_lookup = static_cast<double>(after.major - before.major) / queries.size();
+
+            MappedFile mapped;
+            size_t file_bytes = mapped.open(sortedPath) ? mapped.size() : 0;
+            mapped.close();
+            size_t fence_bytes = index.fenceMemoryBytes();
+            std::remove(sortedPath.c_str());
+
+            std::cout << "  Построение: " << build_time << " нс, прогонов " << runs << ", файл " << file_bytes
+                      << " байт, разделители " << fence_bytes << " байт, поиск холодный / теплый: "
+                      << cold_lookup << " / " << warm_lookup << " нс, отказов страниц на поиск: "
+                      << minor_per_lookup << " + " << major_per_lookup << " (с диска)" << std::endl;
+            external_results_file << size << "," << build_time << "," << runs << "," << file_bytes << ","
+                                  << fence_bytes << "," << cold_lookup << "," << warm_lookup << ","
+                                  << minor_per_lookup << "," << major_per_lookup << "\n";
+        }
+        std::cout << "-------------------------------------\n";
+        external_results_file.close();
+    }
+
+    // Скорость загрузки наборов данных: CSV с разным числом потоков разбора и двоичный формат.
+    // Без аргумента командной строки загружаются сгенерированные файлы размера INGEST_SIZE.
+    if (runSection("ingest")) {
+        pinThreads(true);
+        std::ofstream ingest_results_file(outputPath("ingest_throughput.csv"));
+        ingest_results_file << "Format,Threads,Records,Bytes,Load_ns,MB_per_s\n";
+        std::vector<std::pair<std::string, std::string>> ingest_files;
+        if (!dataset_path.empty()) {
+            ingest_files.emplace_back(dataset_path, dataset_path);
+        } else {
+            std::vector<DataObject> data = generateSeeded(INGEST_SIZE, INGEST_SIZE);
+            const std::string csvPath = outputPath("ingest_dataset.csv");
+            const std::string binaryPath = outputPath("ingest_dataset.bin");
+            if (writeCsvDataset(csvPath, data)) ingest_files.emplace_back("csv", csvPath);
+            if (writeBinaryDataset(binaryPath, data)) ingest_files.emplace_back("binary", binaryPath);
+        }
+        for (const auto& [label, path] : ingest_files) {
+            char magic[8] = {};
+            std::ifstream(path, std::ios::binary).read(magic, sizeof(magic));
+            bool binary = std::memcmp(magic, "LAB2DAT", 8) == 0;
+            std::vector<unsigned> thread_counts = binary ? std::vector<unsigned>{1} : threadCountsToBenchmark(max_threads);
+            for (unsigned threads : thread_counts) {
+                std::cout << "Загрузка " << label << ", потоков " << threads << std::endl;
+                IngestStats stats;
+                bool loaded = false;
+                long long load_time = measureTime([&]() {
+                    std::vector<DataObject> loaded_data;
+                    loaded = loadDataset(path, loaded_data, threads, &stats);
+                });
+                if (!loaded) continue;
+                double mb_per_s = load_time > 0 ? static_cast<double>(stats.bytes) / 1e6 / (load_time / 1e9) : 0.0;
+                std::cout << "  " << stats.records << " записей, " << stats.bytes << " байт, "
+                          << load_time << " нс, " << mb_per_s << " МБ/с" << std::endl;
+                ingest_results_file << (binary ? "binary" : "csv") << "," << threads << "," << stats.records << ","
+                                    << stats.bytes << "," << load_time << "," << mb_per_s << "\n";
+            }
+        }
+        if (dataset_path.empty()) {
+            for (const auto& file : ingest_files) std::remove(file.second.c_str());
+        }
+        std::cout << "-------------------------------------\n";
+        ingest_results_file.close();
+        pinThreads(false);
+    }
+
+    // Сравнение движков на профилях данных: длины ключей, число различных ключей,
+    // перекос кратности дубликатов и общие префиксы. Запросы берутся из данных,
+    // поэтому частые ключи при перекосе запрашиваются чаще.
+    if (runSection("profile")) {
+        std::ofstream profile_results_file(outputPath("profile_search_ns.csv"));
+        profile_results_file << "Profile,Size,Distinct_Keys,Avg_Key_Length";
+        for (const auto& engine : engines) profile_results_file << "," << engine.name << "_Search_ns";
+        profile_results_file << "\n";
+        for (const DataProfile& profile : standardDataProfiles()) {
+            for (size_t size : profile_sizes) {
+                std::cout << "Профиль " << profile.name << ", размер " << size << std::endl;
+                std::vector<DataObject> data = generateSeeded(size, size, profile);
+                std::vector<std::string> keys;
+                keys.reserve(data.size());
+                size_t total_key_length = 0;
+                for (const auto& obj : data) {
+                    keys.push_back(obj.key);
+                    total_key_length += obj.key.size();
+                }
+                std::vector<std::string> queries;
+                std::uniform_int_distribution<size_t> query_dist(0, data.size() - 1);
+                for (size_t i = 0; i < PROFILE_QUERIES; ++i) queries.push_back(data[query_dist(gen)].key);
+                std::sort(keys.begin(), keys.end());
+                size_t distinct_keys = static_cast<size_t>(std::unique(keys.begin(), keys.end()) - keys.begin());
+                double avg_key_length = static_cast<double>(total_key_length) / data.size();
+
+                std::vector<long long> times = measureEngineSearchTimes(engines, data, queries);
+                std::cout << "  Различных ключей " << distinct_keys << ", средняя длина ключа " << avg_key_length << "; поиск:";
+                profile_results_file << profile.name << "," << size << "," << distinct_keys << "," << avg_key_length;
+                for (size_t i = 0; i < engines.size(); ++i) {
+                    std::cout << (i ? ", " : " ") << engines[i].label << " ";
+                    profile_results_file << ",";
+                    if (times[i] < 0) {
+                        std::cout << "пропущен";
+                        continue;
+                    }
+                    std::cout << times[i];
+                    profile_results_file << times[i];
+                }
+                std::cout << " нс" << std::endl;
+                profile_results_file << "\n";
+            }
+        }
+        std::cout << "-------------------------------------\n";
+        profile_results_file.close();
+    }
+
+    // Режимы кеша: warm - один ключ повторяется (как в основном цикле), cold - перед каждым
+    // запросом кеши вытесняются проходом по большому буферу, steady - большой набор случайных
+    // ключей, при котором в кешах остаются только часто посещаемые верхние уровни структур.
+    // Движки с полным просмотром (линейный поиск) в этих режимах не измеряются: они всегда читают весь массив.
+    if (runSection("cache")) {
+        std::ofstream cache_results_file(outputPath("cache_regimes_ns.csv"));
+        cache_results_file << "Size,Regime,Queries";
+        for (const auto& engine : cache_engines) cache_results_file << "," << engine.name << "_Search_ns";
+        cache_results_file << "\n";
+        CacheEvictor evictor;
+        std::cout << "Буфер вытеснения кешей: " << evictor.bytes() / (1u << 20) << " МБ" << std::endl;
+        for (size_t size : cache_regime_sizes) {
+            std::vector<DataObject> data = generateSeeded(size, size, workload_profile);
+            std::uniform_int_distribution<size_t> query_dist(0, data.size() - 1);
+            std::vector<std::string> warm_queries(COLD_QUERIES, data[query_dist(gen)].key);
+            std::vector<std::string> cold_queries;
+            std::vector<std::string> steady_queries;
+            for (size_t i = 0; i < COLD_QUERIES; ++i) cold_queries.push_back(data[query_dist(gen)].key);
+            for (size_t i = 0; i < STEADY_QUERIES; ++i) steady_queries.push_back(data[query_dist(gen)].key);
+
+            auto report = [&](const char* regime, size_t queries, const std::vector<long long>& times) {
+                std::cout << "  " << regime << ":";
+                cache_results_file << size << "," << regime << "," << queries;
+                for (size_t i = 0; i < cache_engines.size(); ++i) {
+                    std::cout << (i ? ", " : " ") << cache_engines[i].label << " ";
+                    cache_results_file << ",";
+                    if (times[i] < 0) {
+                        std::cout << "пропущен";
+                        continue;
+                    }
+                    std::cout << times[i];
+                    cache_results_file << times[i];
+                }
+                std::cout << " нс" << std::endl;
+                cache_results_file << "\n";
+            };
+            std::cout << "Режимы кеша, размер " << size << std::endl;
+            report("warm", warm_queries.size(), measureEngineSearchTimes(cache_engines, data, warm_queries));
+            report("cold", cold_queries.size(),
+                   measureEngineSearchTimes(cache_engines, data, cold_queries, [&]() { evictor.evict(); }));
+            report("steady", steady_queries.size(), measureEngineSearchTimes(cache_engines, data, steady_queries));
+        }
+        std::cout << "-------------------------------------\n";
+        cache_results_file.close();
+    }
+
+    // Целочисленные ключи: BST, RBT и хеш-таблица, инстанцированные для uint64_t, против тех же
+    // структур со строковыми ключами - десятичной записью тех же идентификаторов. Для целого ключа
+    // сравнение и хеш выполняются без ветвлений по длине, элемент цепочки не хранит хеш,
+    // а ключ не занимает памяти вне узла.
+    // Компактное RBT показывает, сколько байт на узел экономит отказ от копии записи и 64-битных указателей.
+    if (runSection("integer")) {
+        std::ofstream integer_results_file(outputPath("integer_keys_ns.csv"));
+        integer_results_file << "Size,Engine,Key_Type,Search_ns,Node_bytes\n";
+        for (size_t size : integer_key_sizes) {
+            using IdRecord = KeyValue<uint64_t, double>;
+            Xoshiro256 rng(seed + size);
+            std::vector<IdRecord> id_records(size);
+            std::vector<DataObject> string_records(size);
+            for (size_t i = 0; i < size; ++i) {
+                uint64_t id = rng.below(10 * static_cast<uint64_t>(size));
+                double value = rng.unit() * 100.0;
+                id_records[i] = IdRecord{id, value};
+                string_records[i] = DataObject(std::to_string(id), 0, value);
+            }
+            std::vector<uint64_t> id_queries;
+            std::vector<std::string> string_queries;
+            for (size_t i = 0; i < WORK_QUERIES; ++i) {
+                size_t index = static_cast<size_t>(rng.below(size));
+                id_queries.push_back(id_records[index].key);
+                string_queries.push_back(string_records[index].key);
+            }
+
+            std::cout << "Целочисленные ключи, размер " << size << std::endl;
+            auto measureKeyType = [&](const char* keyType, const auto& records, const auto& queries) {
+                using Record = typename std::decay_t<decltype(records)>::value_type;
+                using Key = RecordKey<Record>;
+                using Tree = BasicRedBlackTree<Key, Record>;
+                using Table = BasicHashTable<Key, Record>;
+                auto report = [&](const char* engine, long long search_time, size_t node_bytes) {
+                    std::cout << "  " << engine << ", ключ " << keyType << ": поиск " << search_time
+                              << " нс, узел " << node_bytes << " байт" << std::endl;
+                    integer_results_file << size << "," << engine << "," << keyType << ","
+                                         << search_time << "," << node_bytes << "\n";
+                };
+
+                BasicBSTNode<Record>* bstRoot = nullptr;
+                for (const auto& record : records) insertBST(bstRoot, record);
+                report("BST", averageSearchTime(queries, [&](const Key& key) { return searchBST(bstRoot, key); }),
+                       sizeof(BasicBSTNode<Record>));
+                destroyBST(bstRoot);
+
+                Tree tree;
+                tree.build(records);
+                report("RBT", averageSearchTime(queries, [&](const Key& key) { return tree.search(key); }),
+                       sizeof(typename Tree::Node));
+
+                CompactRedBlackTree<Key, Record> compactTree;
+                compactTree.build(records);
+                report("CompactRBT", averageSearchTime(queries, [&](const Key& key) { return compactTree.search(key); }),
+                       sizeof(typename CompactRedBlackTree<Key, Record>::Node));
+
+                Table table(records.size());
+                table.build(records);
+                report("HashTable", averageSearchTime(queries, [&](const Key& key) { return table.search(key); }),
+                       listNodeBytes<typename Table::Entry>());
+            };
+            measureKeyType("string", string_records, string_queries);
+            measureKeyType("uint64", id_records, id_queries);
         }
-        long long avg_multimap_time = (SEARCH_ITERATIONS > 0) ? total_multimap_time / SEARCH_ITERATIONS : 0;
-        std::cout << "  std::multimap поиск Среднее время: " << avg_multimap_time << " нс" << std::endl;
+        std::cout << "-------------------------------------\n";
+        integer_results_file.close();
+    }
 
-        time_results_file << size << ","
-                          << avg_linear_time << ","
-                          << avg_bst_time << ","
-                          << avg_rbt_time << ","
-                          << avg_hashtable_time << ","
-                          << avg_multimap_time << "\n";
+    // Экономные индексы: BST, RBT, хеш-таблица и std::multimap хранят по полной копии каждого
+    // DataObject, а их экономные варианты - только ссылку на ключ (или отпечаток) и номер строки
+    // в одном общем колоночном хранилище. Строка Rows сравнивает исходный вектор с хранилищем.
+    if (runSection("lean")) {
+        std::ofstream lean_results_file(outputPath("lean_memory.csv"));
+        lean_results_file << "Size,Engine,Full_bytes,Lean_bytes,Full_search_ns,Lean_search_ns,Lean_rows_ns\n";
+        for (size_t size : lean_sizes) {
+            std::vector<DataObject> data = generateSeeded(size, size, workload_profile);
+            std::uniform_int_distribution<size_t> query_dist(0, data.size() - 1);
+            std::vector<std::string> queries;
+            for (size_t i = 0; i < WORK_QUERIES; ++i) queries.push_back(data[query_dist(gen)].key);
+            auto store = std::make_shared<RowStore>();
+            if (!store->build(data)) continue;
 
-        collision_results_file << size << "," << collisions << "\n";
+            size_t full_total = data.capacity() * sizeof(DataObject) + keyHeapBytes(data);
+            size_t lean_total = store->memoryUsage();
+            std::cout << "Экономные индексы, размер " << size << std::endl;
+            std::cout << "  Строки: вектор DataObject " << full_total << " байт, колоночное хранилище "
+                      << lean_total << " байт" << std::endl;
+            lean_results_file << size << ",Rows," << full_total << "," << lean_total << ",,,\n";
+
+            // Экономный индекс измеряется через тот же адаптер LeanEngine, что и в основном сравнении,
+            // но строится над общим хранилищем store; его память учитывается без хранилища,
+            // которое показано строкой Rows один раз на четыре индекса.
+            auto compare = [&](const char* name, auto& full, auto& lean) {
+                if (!full.accepts(data) || !lean.accepts(data)) return;
+                full.build(data);
+                lean.buildShared(store);
+                size_t full_bytes = full.memoryUsage();
+                size_t lean_bytes = lean.index().memoryUsage();
+                long long full_time = averageSearchTime(queries, [&](const std::string& key) { return full.search(key); });
+                long long lean_time = averageSearchTime(queries, [&](const std::string& key) { return lean.search(key); });
+                long long rows_time = averageSearchTime(queries, [&](const std::string& key) {
+                    return lean.index().searchRows(key);
+                });
+                full_total += full_bytes;
+                lean_total += lean_bytes;
+                std::cout << "  " << name << ": память " << full_bytes << " -> " << lean_bytes << " байт, поиск "
+                          << full_time << " -> " << lean_time << " нс (только номера строк " << rows_time << " нс)"
+                          << std::endl;
+                lean_results_file << size << "," << name << "," << full_bytes << "," << lean_bytes << ","
+                                  << full_time << "," << lean_time << "," << rows_time << "\n";
+            };
+            {
+                BSTEngine full;
+                LeanEngine<LeanBSTIndex> lean;
+                compare("BST", full, lean);
+            }
+            {
+                RBTEngine full;
+                LeanEngine<LeanRBTIndex> lean;
+                compare("RBT", full, lean);
+            }
+            {
+                HashTableEngine full;
+                LeanEngine<LeanHashIndex> lean;
+                compare("HashTable", full, lean);
+            }
+            {
+                MultimapEngine full;
+                LeanEngine<LeanMultimapIndex> lean;
+                compare("Multimap", full, lean);
+            }
+            std::cout << "  Всего (строки и четыре индекса): " << full_total << " -> " << lean_total << " байт" << std::endl;
+        }
         std::cout << "-------------------------------------\n";
+        lean_results_file.close();
     }
 
-    time_results_file.close();
-    collision_results_file.close();
+    // Скорость генерации данных: исходный generateData (std::mt19937, пул ключей, один поток)
+    // против generateDataParallel с разным числом потоков.
+    if (runSection("generation")) {
+        pinThreads(true);
+        std::ofstream generation_results_file(outputPath("generation_throughput.csv"));
+        generation_results_file << "Generator,Threads,Size,Generate_ns,Mrecords_per_s\n";
+        for (size_t size : generation_sizes) {
+            auto report = [&](const char* generator, unsigned threads, long long generate_time) {
+                double mrecords_per_s = generate_time > 0 ? static_cast<double>(size) / 1e6 / (generate_time / 1e9) : 0.0;
+                std::cout << "  " << generator << ", потоков " << threads << ": " << generate_time << " нс, "
+                          << mrecords_per_s << " млн записей/с" << std::endl;
+                generation_results_file << generator << "," << threads << "," << size << ","
+                                        << generate_time << "," << mrecords_per_s << "\n";
+            };
+            std::cout << "Генерация данных, размер " << size << std::endl;
+            report("generateData", 1, measureTime([&]() { volatile size_t n = generateData(size).size(); (void)n; }));
+            for (unsigned threads : threadCountsToBenchmark(max_threads)) {
+                report("generateDataParallel", threads, measureTime([&]() {
+                    volatile size_t n = generateDataParallel(size, DataProfile(), seed + size, threads).size();
+                    (void)n;
+                }));
+            }
+        }
+        std::cout << "-------------------------------------\n";
+        generation_results_file.close();
+    }
 
-    std::cout << "\nРезультаты сохранены в search_times_ns.csv и hash_collisions.csv" << std::endl;
+    std::cout << "\nРезультаты сохранены в каталог " << options.output_dir << std::endl;
 
     return 0;
 }